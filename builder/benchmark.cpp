@@ -0,0 +1,394 @@
+// Builder benchmark -- what building and serializing one request costs, and
+// the encoders the builder runs on every request.
+//
+// Request scenarios build a realistic request (8 headers, 6 query parameters,
+// a 200-byte JSON body) through the builder chain -- on the heap, a stack
+// arena and a pool --, the director recipes, the static builder, a template
+// and a batch, and serialize a prebuilt one with build_full_url( ),
+// to_string( ) and WireRequest. Encoder scenarios run SIMD against the scalar
+// reference, on short and long inputs.
+//
+// Every scenario reports ns and global heap allocations per request (or per
+// encoded input), counted by the operator new replacements below. One JSON
+// object per scenario is written to --output (default
+// builder_benchmark.jsonl); a readable summary goes to stderr.
+//
+//   builder_benchmark [--iterations N] [--output path]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "request_batch.h"
+#include "request_builder.h"
+#include "request_template.h"
+#include "static_request_builder.h"
+#include "url_encoding.h"
+#include "wire_format.h"
+
+namespace {
+
+// global heap allocations, counted by the replacements below
+std::atomic<size_t> heap_allocations{0};
+
+void* counted_allocate(size_t size, size_t alignment = 0) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size     = size ? size : 1;
+    void* memory =
+        alignment > alignof(std::max_align_t)
+            ? std::aligned_alloc(alignment, (size + alignment - 1) /
+                                                alignment * alignment)
+            : std::malloc(size);
+    if (!memory) throw std::bad_alloc( );
+    return memory;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return counted_allocate(size); }
+void* operator new[](size_t size) { return counted_allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return counted_allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return counted_allocate(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t      iterations = 200000;  // for the shortest input; scaled down
+    std::string output     = "builder_benchmark.jsonl";
+};
+
+struct Scenario {
+    std::string                               name;
+    std::string                               impl;
+    size_t input_bytes;   // 0 for the request scenarios
+    size_t escape_every;  // one byte in this many needs escaping; 0: none
+    std::function<size_t(const std::string&)> run;  // returns output size
+};
+
+struct Result {
+    size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double mb_per_sec;
+};
+
+// query-value-like text: unreserved, with a space or '/' now and then
+std::string make_input(size_t bytes, size_t escape_every) {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string input(bytes, 'x');
+    uint32_t    state = 12345;
+    for (size_t i = 0; i < bytes; ++i) {
+        state    = state * 1103515245 + 12345;
+        bool escape = escape_every && i % escape_every == escape_every - 1;
+        input[i]    = escape ? ((state >> 16) & 1 ? ' ' : '/')
+                             : alphabet[(state >> 16) % 62];
+    }
+    return input;
+}
+
+Result run(const Scenario& scenario, size_t iterations) {
+    std::string input =
+        make_input(scenario.input_bytes, scenario.escape_every);
+
+    // keep the compiler from discarding the work
+    volatile size_t sink = 0;
+    for (size_t i = 0; i < iterations / 10 + 1; ++i)
+        sink = sink + scenario.run(input);
+
+    size_t allocations = heap_allocations.load(std::memory_order_relaxed);
+    auto   start       = Clock::now( );
+    for (size_t i = 0; i < iterations; ++i) sink = sink + scenario.run(input);
+    auto elapsed =
+        std::chrono::duration<double>(Clock::now( ) - start).count( );
+    allocations = heap_allocations.load(std::memory_order_relaxed) -
+                  allocations;
+
+    Result result;
+    result.iterations    = iterations;
+    result.ns_per_op     = elapsed * 1e9 / iterations;
+    result.allocs_per_op = static_cast<double>(allocations) / iterations;
+    result.mb_per_sec =
+        scenario.input_bytes * iterations / elapsed / (1024.0 * 1024.0);
+    return result;
+}
+
+// the variable parts of a realistic API request
+constexpr std::string_view URL = "https://api.example.com/v2/orders";
+constexpr std::string_view JSON_BODY =
+    R"({"order_id": 78912, "customer": {"id": 4411, "tier": "gold"}, )"
+    R"("items": [{"sku": "A-1042", "quantity": 2, "price": 19.99}, )"
+    R"({"sku": "B-0007", "quantity": 1, "price": 149.00}], )"
+    R"("shipping": "express", "note": "leave at door"})";
+
+HttpRequestBuilder& add_realistic_parts(HttpRequestBuilder& builder) {
+    return builder.add_header("Accept", "application/json")
+        .add_header("Accept-Encoding", "gzip, deflate, br")
+        .add_header("User-Agent", "builder-benchmark/1.0")
+        .add_header("X-Request-Id", "4f9c2d1e-8a7b-4c3d-9e2f-1a2b3c4d5e6f")
+        .add_header("X-Client-Version", "2024.11.3")
+        .add_header("Cache-Control", "no-cache")
+        .add_query_param("page", "3")
+        .add_query_param("per_page", "50")
+        .add_query_param("sort", "created_at")
+        .add_query_param("order", "desc")
+        .add_query_param("filter", "status:open region:eu-west")
+        .add_query_param("fields", "id,total,items")
+        .set_json_body(JSON_BODY)
+        .set_bearer_token("eyJhbGciOiJIUzI1NiJ9.eyJzdWIiOiI0NDExIn0.c2lnbmF0");
+}
+
+size_t build_realistic(HttpRequestBuilder&& builder) {
+    return add_realistic_parts(builder).build( )->get_body( ).length( );
+}
+
+// one scenario per way to get a request, and per way to serialize it
+void add_request_scenarios(std::vector<Scenario>& scenarios) {
+    scenarios.push_back({"builder_chain", "heap", 0, 0, [](auto&) {
+                             return build_realistic(
+                                 HttpRequestBuilder(URL, HttpMethod::POST));
+                         }});
+    scenarios.push_back(
+        {"builder_chain", "arena", 0, 0, [](auto&) {
+             std::array<std::byte, 16384>        buffer;
+             std::pmr::monotonic_buffer_resource arena(buffer.data( ),
+                                                       buffer.size( ));
+             return build_realistic(
+                 HttpRequestBuilder(URL, HttpMethod::POST, &arena));
+         }});
+    scenarios.push_back(
+        {"builder_chain", "pool", 0, 0, [](auto&) {
+             static HttpRequestPool pool;
+             return build_realistic(
+                 HttpRequestBuilder(URL, HttpMethod::POST, pool));
+         }});
+    scenarios.push_back(
+        {"director_json", "heap", 0, 0, [](auto&) {
+             return HttpRequestDirector::build_json_api_request(
+                        URL, HttpMethod::POST, JSON_BODY, "demo-api-key")
+                 ->get_body( )
+                 .length( );
+         }});
+    scenarios.push_back(
+        {"director_form", "heap", 0, 0, [](auto&) {
+             static const QueryParams form = {{"username", "jane.doe"},
+                                              {"email", "jane@example.com"},
+                                              {"plan", "team annual"},
+                                              {"seats", "12"}};
+             return HttpRequestDirector::build_form_request(URL, form)
+                 ->get_body( )
+                 .length( );
+         }});
+    scenarios.push_back(
+        {"director_download", "heap", 0, 0, [](auto&) {
+             return HttpRequestDirector::build_download_request(
+                        "https://cdn.example.com/files/report.csv",
+                        "demo-token")
+                 ->get_headers( )
+                 .size( );
+         }});
+    scenarios.push_back(
+        {"static_builder", "heap", 0, 0, [](auto&) {
+             return StaticRequestBuilder<HttpMethod::POST>(
+                        "https://api.example.com/v2/orders")
+                 .header("Accept", "application/json")
+                 .header("User-Agent", "builder-benchmark/1.0")
+                 .header("X-Request-Id", "4f9c2d1e-8a7b-4c3d-9e2f-1a2b3c4d5e6f")
+                 .query_param("page", "3")
+                 .query_param("per_page", "50")
+                 .bearer_token("demo-token")
+                 .json_body(JSON_BODY)
+                 .build( )
+                 ->get_body( )
+                 .length( );
+         }});
+
+    // serializing one prebuilt request
+    static const HttpRequestPtr prebuilt = [] {
+        HttpRequestBuilder builder(URL, HttpMethod::POST);
+        return add_realistic_parts(builder).build( );
+    }( );
+    scenarios.push_back({"build_full_url", "heap", 0, 0, [](auto&) {
+                             return prebuilt->build_full_url( ).size( );
+                         }});
+    scenarios.push_back({"to_string", "heap", 0, 0, [](auto&) {
+                             return prebuilt->to_string( ).size( );
+                         }});
+    scenarios.push_back({"wire_request", "iovec", 0, 0, [](auto&) {
+                             return WireRequest(*prebuilt).size_bytes( );
+                         }});
+
+    scenarios.push_back(
+        {"template_wire", "iovec", 0, 0, [](auto&) {
+             static const RequestTemplate order_template =
+                 RequestTemplate::json_api(
+                     "https://api.example.com/v2/orders/{order_id}",
+                     HttpMethod::PUT, "demo-api-key");
+             static const size_t order_id = order_template.slot("order_id");
+
+             TemplateArguments args(order_template);
+             args.set(order_id, "78912").set_body(JSON_BODY);
+             return WireRequest(order_template, args).size_bytes( );
+         }});
+    scenarios.push_back(
+        {"batch_of_64", "heap", 0, 0, [](auto&) {
+             static const std::vector<std::string> ids = [] {
+                 std::vector<std::string> values;
+                 for (int i = 0; i < 64; ++i)
+                     values.push_back(std::to_string(10000 + i));
+                 return values;
+             }( );
+             static const std::vector<std::string_view> columns(ids.begin( ),
+                                                                ids.end( ));
+             auto base = HttpRequestDirector::build_download_request(
+                 "https://cdn.example.com/files/", "demo-token");
+             return HttpRequestBatch(std::move(base))
+                 .vary_query_param("id", columns)
+                 .build( )
+                 .size( );
+         }});
+}
+
+std::vector<Scenario> make_scenarios( ) {
+    std::vector<Scenario> scenarios;
+    add_request_scenarios(scenarios);
+    for (size_t bytes : {24, 256, 16384}) {
+        scenarios.push_back(
+            {"scan", "simd", bytes, 0, [](const std::string& in) {
+                 return find_url_unsafe(in);
+             }});
+        scenarios.push_back(
+            {"scan", "scalar", bytes, 0, [](const std::string& in) {
+                 return find_url_unsafe_scalar(in, UrlEncoding::COMPONENT);
+             }});
+        scenarios.push_back(
+            {"percent_encode", "simd", bytes, 29, [](const std::string& in) {
+                 std::pmr::string out;
+                 append_url_encoded(out, in);
+                 return out.size( );
+             }});
+        scenarios.push_back(
+            {"form_encode", "simd", bytes, 29, [](const std::string& in) {
+                 std::pmr::string out;
+                 append_url_encoded(out, in, UrlEncoding::FORM);
+                 return out.size( );
+             }});
+        scenarios.push_back(
+            {"base64", url_encoding_simd_level( ), bytes, 0,
+             [](const std::string& in) {
+                 std::string out(base64_encoded_size(in.size( )), '\0');
+                 base64_encode(in, out.data( ));
+                 return static_cast<size_t>(out[0]);
+             }});
+        scenarios.push_back(
+            {"base64", "scalar", bytes, 0, [](const std::string& in) {
+                 std::string out(base64_encoded_size(in.size( )), '\0');
+                 base64_encode_scalar(in, out.data( ));
+                 return static_cast<size_t>(out[0]);
+             }});
+    }
+    return scenarios;
+}
+
+std::string to_json(const Scenario& scenario, const Result& result) {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(1) << "{\"benchmark\":\""
+         << scenario.name << "\",\"impl\":\"" << scenario.impl
+         << "\",\"input_bytes\":" << scenario.input_bytes
+         << ",\"iterations\":" << result.iterations
+         << ",\"ns_per_op\":" << result.ns_per_op << std::setprecision(2)
+         << ",\"allocs_per_op\":" << result.allocs_per_op;
+    if (scenario.input_bytes > 0)
+        json << std::setprecision(1)
+             << ",\"mb_per_sec\":" << result.mb_per_sec;
+    json << "}";
+    return json.str( );
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag  = argv[i];
+        std::string value = argv[i + 1];
+
+        if (flag == "--iterations") {
+            options.iterations = std::stoul(value);
+        } else if (flag == "--output") {
+            options.output = value;
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+        }
+    }
+    options.iterations = std::max<size_t>(1, options.iterations);
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+
+    std::ofstream output(options.output, std::ios::trunc);
+    std::cerr << "simd level: " << url_encoding_simd_level( ) << "\n"
+              << std::left << std::setw(20) << "benchmark" << std::setw(8)
+              << "impl" << std::setw(8) << "bytes" << std::setw(12) << "ns/op"
+              << std::setw(12) << "allocs/op" << "MB/s\n";
+
+    for (const auto& scenario : make_scenarios( )) {
+        // roughly the same bytes processed for every input size; a request
+        // costs about as much as encoding a few kilobytes
+        size_t iterations =
+            scenario.input_bytes
+                ? std::max<size_t>(100, options.iterations * 24 /
+                                            scenario.input_bytes)
+                : std::max<size_t>(100, options.iterations / 4);
+        Result result = run(scenario, iterations);
+        output << to_json(scenario, result) << "\n";
+
+        std::cerr << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(20) << scenario.name << std::setw(8)
+                  << scenario.impl << std::setw(8) << scenario.input_bytes
+                  << std::setw(12) << result.ns_per_op << std::setprecision(2)
+                  << std::setw(12) << result.allocs_per_op;
+        if (scenario.input_bytes > 0)
+            std::cerr << std::setprecision(1) << result.mb_per_sec;
+        std::cerr << "\n";
+    }
+    return 0;
+}
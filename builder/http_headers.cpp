@@ -0,0 +1,64 @@
+#include "http_headers.h"
+
+Headers::Headers(
+    std::initializer_list<std::pair<std::string_view, std::string_view>>
+                   headers,
+    allocator_type alloc)
+    : _entries(alloc) {
+    _entries.reserve(headers.size( ));
+    for (const auto& [name, value] : headers) set(name, value);
+}
+
+Headers::Entry* Headers::find_entry(HeaderName id, std::string_view name) {
+    for (auto& entry : _entries) {
+        if (entry.id != id) continue;
+        if (id != HeaderName::CUSTOM || iequals(entry.custom_name, name))
+            return &entry;
+    }
+    return nullptr;
+}
+
+void Headers::set_entry(HeaderName id, std::string_view name,
+                        std::pmr::string&& value) {
+    if (auto* entry = find_entry(id, name)) {
+        entry->value = std::move(value);
+        return;
+    }
+
+    if (_entries.capacity( ) == 0) _entries.reserve(8);
+    _entries.emplace_back(id, name, std::move(value));
+}
+
+void Headers::set(std::string_view name, std::string_view value) {
+    set_entry(intern_header_name(name), name,
+              std::pmr::string(value, get_allocator( )));
+}
+
+void Headers::set(std::string_view name, std::pmr::string&& value) {
+    set_entry(intern_header_name(name), name, std::move(value));
+}
+
+void Headers::set(HeaderName id, std::string_view value) {
+    set_entry(id, header_name_string(id),
+              std::pmr::string(value, get_allocator( )));
+}
+
+void Headers::set(HeaderName id, std::pmr::string&& value) {
+    set_entry(id, header_name_string(id), std::move(value));
+}
+
+const Headers::Entry* Headers::find(std::string_view name) const {
+    return const_cast<Headers*>(this)->find_entry(intern_header_name(name),
+                                                  name);
+}
+
+const Headers::Entry* Headers::find(HeaderName id) const {
+    return const_cast<Headers*>(this)->find_entry(id, { });
+}
+
+bool Headers::erase(std::string_view name) {
+    auto* entry = find_entry(intern_header_name(name), name);
+    if (!entry) return false;
+    _entries.erase(_entries.begin( ) + (entry - _entries.data( )));
+    return true;
+}
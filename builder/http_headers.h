@@ -0,0 +1,178 @@
+#ifndef HTTP_HEADERS_H
+#define HTTP_HEADERS_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Header names common enough to be stored as a token instead of a string.
+ * Matching against them is a byte compare, and their canonical spelling is a
+ * static string.
+ */
+enum class HeaderName : std::uint8_t {
+    CUSTOM = 0,
+    ACCEPT,
+    ACCEPT_ENCODING,
+    AUTHORIZATION,
+    CACHE_CONTROL,
+    CONNECTION,
+    CONTENT_LENGTH,
+    CONTENT_TYPE,
+    COOKIE,
+    HOST,
+    IF_MODIFIED_SINCE,
+    IF_NONE_MATCH,
+    RANGE,
+    TRANSFER_ENCODING,
+    USER_AGENT,
+    X_API_KEY,
+};
+
+// canonical spellings, indexed by HeaderName
+inline constexpr std::array<std::string_view, 16> header_names = {
+    "",
+    "Accept",
+    "Accept-Encoding",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Range",
+    "Transfer-Encoding",
+    "User-Agent",
+    "X-API-Key",
+};
+
+// canonical spelling ("Content-Type"); empty for CUSTOM
+constexpr std::string_view header_name_string(HeaderName id) {
+    return header_names[static_cast<size_t>(id)];
+}
+
+// ASCII case-insensitive equality, as HTTP field names require
+constexpr bool iequals(std::string_view a, std::string_view b) {
+    if (a.size( ) != b.size( )) return false;
+    for (size_t i = 0; i < a.size( ); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x + ('a' - 'A'));
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y + ('a' - 'A'));
+        if (x != y) return false;
+    }
+    return true;
+}
+
+// case-insensitive lookup of a well-known name; CUSTOM if it is not one.
+// constexpr, so names known at compile time are interned there
+constexpr HeaderName intern_header_name(std::string_view name) {
+    // the length check rejects almost every candidate before a byte is read
+    for (size_t i = 1; i < header_names.size( ); ++i) {
+        if (iequals(name, header_names[i])) return static_cast<HeaderName>(i);
+    }
+    return HeaderName::CUSTOM;
+}
+
+/**
+ * Flat header container.
+ *
+ * Entries sit in one contiguous vector in insertion order -- typical requests
+ * carry 5 to 20 headers, where a linear scan over interned tokens beats any
+ * hashing. Names match case-insensitively. Allocator-aware, like HttpRequest.
+ */
+class Headers {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    struct Entry {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        HeaderName       id;
+        std::pmr::string custom_name;  // only used when id == CUSTOM
+        std::pmr::string value;
+
+        Entry(HeaderName id, std::string_view name, std::pmr::string&& value,
+              allocator_type alloc)
+            : id(id),
+              custom_name(id == HeaderName::CUSTOM ? name : std::string_view{ },
+                          alloc),
+              value(std::move(value), alloc) {}
+
+        Entry(const Entry& other, allocator_type alloc)
+            : id(other.id),
+              custom_name(other.custom_name, alloc),
+              value(other.value, alloc) {}
+
+        Entry(Entry&& other, allocator_type alloc)
+            : id(other.id),
+              custom_name(std::move(other.custom_name), alloc),
+              value(std::move(other.value), alloc) {}
+
+        Entry(const Entry&)            = default;
+        Entry(Entry&&)                 = default;
+        Entry& operator=(const Entry&) = default;
+        Entry& operator=(Entry&&)      = default;
+
+        std::string_view name( ) const {
+            return id == HeaderName::CUSTOM ? std::string_view(custom_name)
+                                            : header_name_string(id);
+        }
+    };
+
+    using const_iterator = std::pmr::vector<Entry>::const_iterator;
+
+    explicit Headers(allocator_type alloc = { }) : _entries(alloc) {}
+
+    Headers(std::initializer_list<std::pair<std::string_view, std::string_view>>
+                           headers,
+            allocator_type alloc = { });
+
+    Headers(const Headers& other, allocator_type alloc)
+        : _entries(other._entries, alloc) {}
+
+    Headers(const Headers&)            = default;
+    Headers(Headers&&)                 = default;
+    Headers& operator=(const Headers&) = default;
+    Headers& operator=(Headers&&)      = default;
+
+    allocator_type get_allocator( ) const { return _entries.get_allocator( ); }
+
+    // replaces the value of an existing header (any case), or appends one
+    void set(std::string_view name, std::string_view value);
+    void set(std::string_view name, std::pmr::string&& value);
+    void set(HeaderName id, std::string_view value);
+    void set(HeaderName id, std::pmr::string&& value);
+
+    const Entry* find(std::string_view name) const;
+    const Entry* find(HeaderName id) const;
+
+    bool contains(std::string_view name) const { return find(name); }
+    bool contains(HeaderName id) const { return find(id); }
+
+    bool erase(std::string_view name);
+
+    size_t size( ) const { return _entries.size( ); }
+    bool   empty( ) const { return _entries.empty( ); }
+    void   clear( ) { _entries.clear( ); }
+    void   reserve(size_t count) { _entries.reserve(count); }
+
+    const_iterator begin( ) const { return _entries.begin( ); }
+    const_iterator end( ) const { return _entries.end( ); }
+
+private:
+    std::pmr::vector<Entry> _entries;
+
+    Entry* find_entry(HeaderName id, std::string_view name);
+    void   set_entry(HeaderName id, std::string_view name,
+                     std::pmr::string&& value);
+};
+
+#endif  // HTTP_HEADERS_H
@@ -1,7 +1,18 @@
+#include <array>
+#include <cstddef>
 #include <exception>
 #include <iostream>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
 
+#include <unistd.h>
+
+#include "request_batch.h"
 #include "request_builder.h"
+#include "request_template.h"
+#include "static_request_builder.h"
+#include "wire_format.h"
 
 void builder_pattern_demo( ) {
     std::cout << "=== HTTP Request Builder Pattern Demo ===\n";
@@ -17,6 +28,85 @@ void builder_pattern_demo( ) {
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what( ) << "\n";
     }
+
+    try {
+        std::cout << "2. POST Request built on a stack arena:\n";
+        std::array<std::byte, 4096>         buffer;
+        std::pmr::monotonic_buffer_resource arena(
+            buffer.data( ), buffer.size( ), std::pmr::null_memory_resource( ));
+
+        auto arena_request = HttpRequestDirector::build_json_api_request(
+            "https://reqbin.com/echo/post/json", HttpMethod::POST,
+            R"({"id": 78912, "quantity": 1})", "demo-api-key", &arena);
+        std::cout << arena_request->to_string( ) << "\n\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what( ) << "\n";
+    }
+
+    try {
+        std::cout << "3. The same request on the wire (writev):\n";
+        auto request = HttpRequestDirector::build_json_api_request(
+            "https://reqbin.com/echo/post/json", HttpMethod::POST,
+            R"({"id": 78912, "quantity": 1})", "demo-api-key");
+
+        WireRequest wire(*request);
+        std::cout.flush( );
+        if (writev(STDOUT_FILENO, wire.data( ), wire.count( )) < 0)
+            std::cerr << "writev failed\n";
+        std::cout << "\n(" << wire.count( ) << " segments, "
+                  << wire.size_bytes( ) << " bytes)\n\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what( ) << "\n";
+    }
+
+    try {
+        std::cout << "4. Statically checked request:\n";
+        using namespace std::chrono_literals;
+        auto static_request =
+            StaticRequestBuilder<HttpMethod::PATCH>(
+                "https://reqbin.com/echo/patch/json")
+                .header("Accept", "application/json")
+                .read_timeout(2s)
+                .json_body(R"({"quantity": 3})")
+                .build( );
+        std::cout << static_request->to_string( ) << "\n\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what( ) << "\n";
+    }
+
+    try {
+        std::cout << "5. A batch sharing headers and auth:\n";
+        auto base = HttpRequestDirector::build_download_request(
+            "https://reqbin.com/files/", "demo-token");
+
+        std::vector<std::string_view> files = {"a.csv", "b.csv", "c.csv"};
+        auto requests =
+            HttpRequestBatch(std::move(base)).vary_path(files).build( );
+        for (const auto& request : requests)
+            std::cout << request->get_method_string( ) << " "
+                      << request->build_full_url( ) << "\n";
+        std::cout << "shared common parts: " << std::boolalpha
+                  << requests[0]->shares_common_with(*requests[2]) << "\n\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what( ) << "\n";
+    }
+
+    try {
+        std::cout << "6. Requests from a precompiled template:\n";
+        auto order_template = RequestTemplate::json_api(
+            "https://reqbin.com/orders/{order_id}/items", HttpMethod::PUT,
+            "demo-api-key");
+        auto order_id = order_template.slot("order_id");
+
+        for (auto id : {"1001", "1002"}) {
+            TemplateArguments args(order_template);
+            args.set(order_id, id).set_body(R"({"quantity": 2})");
+            std::cout << WireRequest(order_template, args).to_string( )
+                      << "\n\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what( ) << "\n";
+    }
 }
 
 int main( ) {
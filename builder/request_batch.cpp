@@ -0,0 +1,80 @@
+#include "request_batch.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include "url_encoding.h"
+
+HttpRequestBatch::HttpRequestBatch(HttpRequestPtr base)
+    : _base(std::move(base)) {
+    if (!_base) throw std::invalid_argument("Batch needs a base request");
+}
+
+void HttpRequestBatch::add_column(size_t rows) {
+    if (_has_columns && rows != _rows)
+        throw std::invalid_argument(
+            "All batch columns must have the same number of values");
+    _rows        = rows;
+    _has_columns = true;
+}
+
+HttpRequestBatch& HttpRequestBatch::vary_path(
+    std::span<const std::string_view> suffixes) {
+    add_column(suffixes.size( ));
+    _path_suffixes = suffixes;
+    return *this;
+}
+
+HttpRequestBatch& HttpRequestBatch::vary_query_param(
+    std::string_view key, std::span<const std::string_view> values) {
+    add_column(values.size( ));
+
+    std::pmr::string encoded_key(_base->get_allocator( ));
+    append_url_encoded(encoded_key, key);
+    _query_columns.push_back({std::move(encoded_key), values});
+    return *this;
+}
+
+HttpRequestBatch& HttpRequestBatch::vary_body(
+    std::span<const std::string_view> bodies, bool borrow) {
+    if (!_base->get_headers( ).contains(HeaderName::CONTENT_TYPE))
+        throw std::runtime_error(
+            "Batch requests with body must have 'Content-Type' header");
+
+    add_column(bodies.size( ));
+    _bodies        = bodies;
+    _borrow_bodies = borrow;
+    return *this;
+}
+
+std::vector<HttpRequestPtr> HttpRequestBatch::build( ) const {
+    auto* resource = _base->get_allocator( ).resource( );
+
+    std::vector<HttpRequestPtr> requests;
+    requests.reserve(_rows);
+
+    for (size_t row = 0; row < _rows; ++row) {
+        // same resource as the base, so the common parts are shared
+        auto request = HttpRequest::create(resource, *_base);
+
+        if (!_path_suffixes.empty( )) request->_url.append(_path_suffixes[row]);
+
+        for (const auto& column : _query_columns) {
+            std::pmr::string value(request->get_allocator( ));
+            append_url_encoded(value, column.values[row]);
+            request->_query_params.insert_or_assign(
+                std::pmr::string(column.key, request->get_allocator( )),
+                std::move(value));
+        }
+
+        if (!_bodies.empty( )) {
+            if (_borrow_bodies)
+                request->_body.borrow(_bodies[row]);
+            else
+                request->_body.assign(_bodies[row]);
+        }
+
+        requests.push_back(std::move(request));
+    }
+    return requests;
+}
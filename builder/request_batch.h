@@ -0,0 +1,69 @@
+#ifndef REQUEST_BATCH_H
+#define REQUEST_BATCH_H
+
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "request_builder.h"
+
+/**
+ * Fan-out builder: N requests that differ from one base request only in a
+ * column of values -- a path suffix, a query parameter, the body.
+ *
+ * Every request shares the base's RequestCommon (headers, auth, timeouts) by
+ * reference instead of copying it, so memory and build time scale with the
+ * varying part only. Requests are allocated from the base's memory resource,
+ * which must outlive them.
+ *
+ *   std::vector<std::string_view> ids = {"17", "42", "99"};
+ *   auto requests = HttpRequestBatch(std::move(base))
+ *                       .vary_query_param("id", ids)
+ *                       .build( );
+ *
+ * Columns are views: the values must stay alive until build( ), and borrowed
+ * bodies for as long as the requests.
+ */
+class HttpRequestBatch {
+public:
+    explicit HttpRequestBatch(HttpRequestPtr base);
+
+    // appended to the base URL as given
+    HttpRequestBatch& vary_path(std::span<const std::string_view> suffixes);
+
+    // percent-encoded, like HttpRequestBuilder::add_query_param
+    HttpRequestBatch& vary_query_param(
+        std::string_view key, std::span<const std::string_view> values);
+
+    // copied into each request, or borrowed (see RequestBody) -- the base
+    // must have a Content-Type
+    HttpRequestBatch& vary_body(std::span<const std::string_view> bodies,
+                                bool borrow = false);
+
+    // rows in the batch; all columns have this many values
+    size_t size( ) const { return _rows; }
+
+    const HttpRequest& base( ) const { return *_base; }
+
+    std::vector<HttpRequestPtr> build( ) const;
+
+private:
+    struct QueryColumn {
+        std::pmr::string                  key;  // encoded
+        std::span<const std::string_view> values;
+    };
+
+    HttpRequestPtr                    _base;
+    std::span<const std::string_view> _path_suffixes;
+    std::vector<QueryColumn>          _query_columns;
+    std::span<const std::string_view> _bodies;
+    bool                              _borrow_bodies = false;
+    size_t                            _rows          = 0;
+    bool                              _has_columns   = false;
+
+    // throws std::invalid_argument when a column's length differs
+    void add_column(size_t rows);
+};
+
+#endif  // REQUEST_BATCH_H
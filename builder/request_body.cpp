@@ -0,0 +1,131 @@
+#include "request_body.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str( ), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category( ),
+                                "Cannot open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category( ),
+                                "Cannot stat " + path);
+    }
+
+    _size = static_cast<size_t>(info.st_size);
+    // an empty file cannot be mapped, and needs no mapping
+    if (_size > 0) {
+        _data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (_data == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category( ),
+                                    "Cannot map " + path);
+        }
+        // sent front to back: read ahead, and drop pages once sent
+        ::madvise(_data, _size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile( ) {
+    if (_data) ::munmap(_data, _size);
+}
+
+RequestBody::RequestBody(const RequestBody& other, allocator_type alloc)
+    : _kind(other._kind),
+      _owned(other._owned, alloc),
+      _borrowed(other._borrowed),
+      _file(other._file),
+      _generator(other._generator),
+      _length(other._length) {}
+
+void RequestBody::assign(std::string_view bytes) {
+    clear( );
+    _owned.assign(bytes);
+    _length = _owned.size( );
+}
+
+void RequestBody::assign(std::pmr::string&& bytes) {
+    clear( );
+    _owned  = std::move(bytes);
+    _length = _owned.size( );
+}
+
+void RequestBody::borrow(std::string_view bytes) {
+    clear( );
+    _kind     = Kind::BORROWED;
+    _borrowed = bytes;
+    _length   = bytes.size( );
+}
+
+void RequestBody::map_file(const std::string& path) {
+    auto file = std::allocate_shared<const MappedFile>(
+        std::pmr::polymorphic_allocator<MappedFile>(get_allocator( )), path);
+
+    clear( );
+    _kind     = Kind::MAPPED_FILE;
+    _file     = std::move(file);
+    _borrowed = _file->bytes( );
+    _length   = _borrowed.size( );
+}
+
+void RequestBody::generate(Generator generator, size_t length) {
+    clear( );
+    _kind      = Kind::GENERATOR;
+    _generator = std::move(generator);
+    _length    = length;
+}
+
+void RequestBody::clear( ) {
+    // keeps the owned buffer's capacity, for pooled requests
+    _kind = Kind::OWNED;
+    _owned.clear( );
+    _borrowed = { };
+    _file.reset( );
+    _generator = nullptr;
+    _length    = 0;
+}
+
+std::pmr::string& RequestBody::owned_buffer( ) {
+    clear( );
+    return _owned;
+}
+
+std::string_view RequestBody::view( ) const {
+    switch (_kind) {
+        case Kind::OWNED:
+            return _owned;
+        case Kind::BORROWED:
+        case Kind::MAPPED_FILE:
+            return _borrowed;
+        case Kind::GENERATOR:
+            break;
+    }
+    throw std::logic_error("A generated body has no contiguous view");
+}
+
+size_t RequestBody::Reader::read(char* buffer, size_t capacity) {
+    if (_body->_kind == Kind::GENERATOR)
+        return _body->_generator(buffer, capacity);
+
+    auto   bytes = _body->view( ).substr(_offset);
+    size_t count = std::min(capacity, bytes.size( ));
+    std::memcpy(buffer, bytes.data( ), count);
+    _offset += count;
+    return count;
+}
@@ -0,0 +1,118 @@
+#ifndef REQUEST_BODY_H
+#define REQUEST_BODY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+/**
+ * A read-only memory mapping of a whole file. Shared between the bodies (and
+ * request copies) that refer to it, and unmapped with the last of them.
+ */
+class MappedFile {
+public:
+    // throws std::system_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile( );
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view bytes( ) const {
+        return {static_cast<const char*>(_data), _size};
+    }
+
+private:
+    void*  _data = nullptr;
+    size_t _size = 0;
+};
+
+/**
+ * Where a request's body comes from, without materializing it:
+ *
+ *   OWNED        bytes copied into the request's memory resource
+ *   BORROWED     a view of the caller's bytes -- they must outlive the request
+ *   MAPPED_FILE  a file mapped into memory, paged in as it is sent
+ *   GENERATOR    a callback producing the body chunk by chunk, with a known
+ *                length or not (then it goes out chunked)
+ *
+ * Only OWNED holds the bytes, so uploading a large file or a generated stream
+ * runs in constant memory. The first three are contiguous and can be sent
+ * zero-copy from view(); all four can be read sequentially through a Reader.
+ *
+ * Allocator-aware, like HttpRequest.
+ */
+class RequestBody {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    enum class Kind { OWNED, BORROWED, MAPPED_FILE, GENERATOR };
+
+    static constexpr size_t UNKNOWN_LENGTH = SIZE_MAX;
+
+    // fills up to `capacity` bytes of `buffer` and returns how many it wrote;
+    // 0 ends the body
+    using Generator = std::function<size_t(char* buffer, size_t capacity)>;
+
+    /**
+     * Sequential reader over any kind of body. A generator body can be read
+     * once only, by one reader.
+     */
+    class Reader {
+    public:
+        explicit Reader(const RequestBody& body) : _body(&body) {}
+
+        // copies up to `capacity` bytes; 0 at the end of the body
+        size_t read(char* buffer, size_t capacity);
+
+    private:
+        const RequestBody* _body;
+        size_t             _offset = 0;
+    };
+
+    explicit RequestBody(allocator_type alloc = { }) : _owned(alloc) {}
+
+    RequestBody(const RequestBody& other, allocator_type alloc);
+
+    RequestBody(const RequestBody&)            = default;
+    RequestBody(RequestBody&&)                 = default;
+    RequestBody& operator=(const RequestBody&) = default;
+    RequestBody& operator=(RequestBody&&)      = default;
+
+    void assign(std::string_view bytes);
+    void assign(std::pmr::string&& bytes);
+    void borrow(std::string_view bytes);
+    void map_file(const std::string& path);
+    void generate(Generator generator, size_t length = UNKNOWN_LENGTH);
+    void clear( );
+
+    // an empty OWNED body to build in place -- call update_length( ) after
+    std::pmr::string& owned_buffer( );
+    void              update_length( ) { _length = _owned.size( ); }
+
+    Kind   kind( ) const { return _kind; }
+    size_t length( ) const { return _length; }
+    bool   has_known_length( ) const { return _length != UNKNOWN_LENGTH; }
+    bool   empty( ) const { return _length == 0; }
+    bool   is_contiguous( ) const { return _kind != Kind::GENERATOR; }
+
+    // the bytes of a contiguous body; throws std::logic_error for a generator
+    std::string_view view( ) const;
+
+    Reader reader( ) const { return Reader(*this); }
+
+    allocator_type get_allocator( ) const { return _owned.get_allocator( ); }
+
+private:
+    Kind                              _kind = Kind::OWNED;
+    std::pmr::string                  _owned;
+    std::string_view                  _borrowed;  // BORROWED and MAPPED_FILE
+    std::shared_ptr<const MappedFile> _file;
+    Generator                         _generator;
+    size_t                            _length = 0;
+};
+
+#endif  // REQUEST_BODY_H
@@ -1,21 +1,125 @@
 #include "request_builder.h"
 
 #include <memory>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
 
-HttpRequest::HttpRequest(const std::string& url, HttpMethod method)
-    : _url(url),
+#include "url_encoding.h"
+
+HttpRequest::HttpRequest(std::string_view url, HttpMethod method,
+                         allocator_type alloc)
+    : _url(url, alloc),
       _method(method),
-      _connect_timeout(5000),
-      _read_timeout(30000),
-      _follow_redirects(true),
-      _max_redirects(5),
-      _verify_ssl(true) {}
+      _query_params(alloc),
+      _body(alloc),
+      _common(std::allocate_shared<RequestCommon>(
+          std::pmr::polymorphic_allocator<RequestCommon>(alloc))) {}
+
+HttpRequest::HttpRequest(const HttpRequest& other, allocator_type alloc)
+    : _url(other._url, alloc),
+      _method(other._method),
+      _query_params(other._query_params, alloc),
+      _body(other._body, alloc),
+      // shared only within one memory resource, which then outlives both
+      _common(other.get_allocator( ) == alloc
+                  ? other._common
+                  : std::allocate_shared<RequestCommon>(
+                        std::pmr::polymorphic_allocator<RequestCommon>(alloc),
+                        *other._common)) {}
+
+void RequestCommon::reset( ) {
+    headers.clear( );
+    connect_timeout  = Timeout(5000);
+    read_timeout     = Timeout(30000);
+    follow_redirects = true;
+    max_redirects    = 5;
+    verify_ssl       = true;
+
+    auth_config.type = AuthType::NONE;
+    auth_config.username.clear( );
+    auth_config.password.clear( );
+    auth_config.token.clear( );
+    auth_config.api_key.clear( );
+    auth_config.api_key_header.assign("X-API-Key");
+}
+
+RequestCommon& HttpRequest::common( ) {
+    // only the builder (and batch / template code) writes, while it is the
+    // sole owner of this request -- so a count of 1 cannot change under us
+    if (_common.use_count( ) > 1) {
+        _common = std::allocate_shared<RequestCommon>(
+            std::pmr::polymorphic_allocator<RequestCommon>(get_allocator( )),
+            *_common);
+    }
+    return *_common;
+}
+
+void HttpRequest::reset(std::string_view url, HttpMethod method) {
+    _url.assign(url);
+    _method = method;
+    _query_params.clear( );
+    _body.clear( );
+
+    if (_common.use_count( ) == 1)
+        _common->reset( );
+    else
+        _common = std::allocate_shared<RequestCommon>(
+            std::pmr::polymorphic_allocator<RequestCommon>(get_allocator( )));
+}
+
+void HttpRequestDeleter::operator( )(HttpRequest* request) const {
+    if (pool) {
+        pool->release(request);
+        return;
+    }
+
+    request->~HttpRequest( );
+    resource->deallocate(request, sizeof(HttpRequest), alignof(HttpRequest));
+}
+
+HttpRequestPool::HttpRequestPool(size_t                     max_idle,
+                                 std::pmr::memory_resource* upstream)
+    : _resource(upstream), _free(&_resource), _max_idle(max_idle) {
+    _free.reserve(max_idle);
+}
+
+HttpRequestPool::~HttpRequestPool( ) {
+    for (auto* request : _free) {
+        request->~HttpRequest( );
+        _resource.deallocate(request, sizeof(HttpRequest),
+                             alignof(HttpRequest));
+    }
+}
+
+HttpRequestPtr HttpRequestPool::acquire(std::string_view url,
+                                        HttpMethod       method) {
+    HttpRequest* request;
+    if (!_free.empty( )) {
+        request = _free.back( );
+        _free.pop_back( );
+        request->reset(url, method);
+    } else {
+        void* memory =
+            _resource.allocate(sizeof(HttpRequest), alignof(HttpRequest));
+        request = new (memory) HttpRequest(url, method, &_resource);
+    }
+    return HttpRequestPtr(request, HttpRequestDeleter{&_resource, this});
+}
+
+void HttpRequestPool::release(HttpRequest* request) {
+    if (_free.size( ) < _max_idle) {
+        _free.push_back(request);
+        return;
+    }
+
+    request->~HttpRequest( );
+    _resource.deallocate(request, sizeof(HttpRequest), alignof(HttpRequest));
+}
 
 std::string HttpRequest::build_full_url( ) const {
-    if (_query_params.empty( )) return _url;
+    if (_query_params.empty( )) return std::string(_url);
 
     std::ostringstream url_stream;
     url_stream << _url;
@@ -54,18 +158,31 @@ std::string HttpRequest::to_string( ) const {
     std::ostringstream ss;
     ss << get_method_string( ) << " " << build_full_url( ) << "\n";
 
-    for (const auto& [key, value] : _headers)
-        ss << key << ": " << value << "\n";
+    for (const auto& header : get_headers( ))
+        ss << header.name( ) << ": " << header.value << "\n";
 
-    if (!_body.empty( )) ss << "\n" << _body;
+    if (_body.is_contiguous( )) {
+        if (!_body.empty( )) ss << "\n" << _body.view( );
+    } else if (_body.has_known_length( )) {
+        ss << "\n<generated body, " << _body.length( ) << " bytes>";
+    } else {
+        ss << "\n<generated body, chunked>";
+    }
 
     return ss.str( );
 }
 
-HttpRequestBuilder::HttpRequestBuilder(const std::string& url,
-                                       HttpMethod         method) {
+HttpRequestBuilder::HttpRequestBuilder(std::string_view           url,
+                                       HttpMethod                 method,
+                                       std::pmr::memory_resource* resource) {
+    validate_url(url);
+    _request = HttpRequest::create(resource, url, method);
+}
+
+HttpRequestBuilder::HttpRequestBuilder(std::string_view url, HttpMethod method,
+                                       HttpRequestPool& pool) {
     validate_url(url);
-    _request = std::unique_ptr<HttpRequest>(new HttpRequest(url, method));
+    _request = pool.acquire(url, method);
 }
 
 void HttpRequestBuilder::ensure_not_built( ) const {
@@ -75,33 +192,67 @@ void HttpRequestBuilder::ensure_not_built( ) const {
             "request");
 }
 
-void HttpRequestBuilder::validate_url(const std::string& url) const {
+void HttpRequestBuilder::validate_url(std::string_view url) const {
     if (url.empty( )) throw std::invalid_argument("URL cannot be empty");
 
     // this is a very basic validation -- needs improvements to handle all cases
-    if (url.find("http://") != 0 && url.find("https://") != 0)
+    if (!url.starts_with("http://") && !url.starts_with("https://"))
         throw std::invalid_argument("URL must start with http:// or https://");
 }
 
-HttpRequestBuilder& HttpRequestBuilder::add_header(const std::string& key,
-                                                   const std::string& value) {
+// keys and values are percent-encoded into the request's own memory resource
+static void assign_entry(QueryParams& map, std::string_view key,
+                         std::pmr::string&& value) {
+    std::pmr::string stored_key(map.get_allocator( ));
+    append_url_encoded(stored_key, key);
+
+    if (find_url_unsafe(value) != value.size( )) {
+        std::pmr::string encoded(map.get_allocator( ));
+        append_url_encoded(encoded, value);
+        value = std::move(encoded);
+    }
+
+    auto it = map.find(stored_key);
+    if (it != map.end( ))
+        it->second = std::move(value);
+    else
+        map.emplace(std::move(stored_key), std::move(value));
+}
+
+void HttpRequestBuilder::set_header(std::string_view   key,
+                                    std::pmr::string&& value) {
+    _request->common( ).headers.set(key, std::move(value));
+}
+
+void HttpRequestBuilder::set_header(HeaderName id, std::pmr::string&& value) {
+    _request->common( ).headers.set(id, std::move(value));
+}
+
+void HttpRequestBuilder::set_query_param(std::string_view   key,
+                                         std::pmr::string&& value) {
+    assign_entry(_request->_query_params, key, std::move(value));
+}
+
+HttpRequestBuilder& HttpRequestBuilder::add_header(std::string_view key,
+                                                   std::string_view value) {
     ensure_not_built( );
-    _request->_headers[key] = value;
+    set_header(key, std::pmr::string(value, _request->get_allocator( )));
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::add_headers(const Headers& headers) {
     ensure_not_built( );
-    for (const auto& [key, value] : headers) {
-        _request->_headers[key] = value;
+    for (const auto& header : headers) {
+        set_header(header.name( ),
+                   std::pmr::string(header.value, _request->get_allocator( )));
     }
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::add_query_param(
-    const std::string& key, const std::string& value) {
+    std::string_view key, std::string_view value) {
     ensure_not_built( );
-    _request->_query_params[key] = value;
+    set_query_param(key, std::pmr::string(value, _request->get_allocator( )));
     return *this;
 }
 
@@ -109,21 +260,24 @@ HttpRequestBuilder& HttpRequestBuilder::add_query_params(
     const QueryParams& params) {
     ensure_not_built( );
     for (const auto& [key, value] : params) {
-        _request->_query_params[key] = value;
+        set_query_param(key,
+                        std::pmr::string(value, _request->get_allocator( )));
     }
     return *this;
 }
 
-HttpRequestBuilder& HttpRequestBuilder::set_body(const std::string& body) {
+HttpRequestBuilder& HttpRequestBuilder::set_body(std::string_view body) {
     ensure_not_built( );
-    _request->_body = body;
+    _request->_body.assign(body);
     return *this;
 }
 
-HttpRequestBuilder& HttpRequestBuilder::set_json_body(const std::string& json) {
+HttpRequestBuilder& HttpRequestBuilder::set_json_body(std::string_view json) {
     ensure_not_built( );
-    _request->_body                    = json;
-    _request->_headers["Content-Type"] = "application/json";
+    _request->_body.assign(json);
+    set_header(HeaderName::CONTENT_TYPE,
+               std::pmr::string("application/json",
+                                _request->get_allocator( )));
     return *this;
 }
 
@@ -131,15 +285,54 @@ HttpRequestBuilder& HttpRequestBuilder::set_form_body(
     const QueryParams& form_data) {
     ensure_not_built( );
 
-    std::ostringstream body_stream;
-    bool               first = true;
+    size_t length = 0;
+    for (const auto& [key, value] : form_data)
+        length += key.size( ) + value.size( ) + 2;
+
+    auto& body = _request->_body.owned_buffer( );
+    body.reserve(length);
+
+    bool first = true;
     for (const auto& [key, value] : form_data) {
-        body_stream << (first ? "" : "&") << key << "=" << value;
+        if (!first) body += '&';
+        append_url_encoded(body, key, UrlEncoding::FORM);
+        body += '=';
+        append_url_encoded(body, value, UrlEncoding::FORM);
         first = false;
     }
+    _request->_body.update_length( );
 
-    _request->_body                    = body_stream.str( );
-    _request->_headers["Content-Type"] = "application/x-www-form-urlencoded";
+    set_header(HeaderName::CONTENT_TYPE,
+               std::pmr::string("application/x-www-form-urlencoded",
+                                _request->get_allocator( )));
+    return *this;
+}
+
+HttpRequestBuilder& HttpRequestBuilder::borrow_body(
+    std::string_view body, std::string_view content_type) {
+    ensure_not_built( );
+    _request->_body.borrow(body);
+    set_header(HeaderName::CONTENT_TYPE,
+               std::pmr::string(content_type, _request->get_allocator( )));
+    return *this;
+}
+
+HttpRequestBuilder& HttpRequestBuilder::set_file_body(
+    const std::string& path, std::string_view content_type) {
+    ensure_not_built( );
+    _request->_body.map_file(path);
+    set_header(HeaderName::CONTENT_TYPE,
+               std::pmr::string(content_type, _request->get_allocator( )));
+    return *this;
+}
+
+HttpRequestBuilder& HttpRequestBuilder::set_generated_body(
+    RequestBody::Generator generator, size_t length,
+    std::string_view content_type) {
+    ensure_not_built( );
+    _request->_body.generate(std::move(generator), length);
+    set_header(HeaderName::CONTENT_TYPE,
+               std::pmr::string(content_type, _request->get_allocator( )));
     return *this;
 }
 
@@ -147,7 +340,7 @@ HttpRequestBuilder& HttpRequestBuilder::set_connect_timeout(Timeout timeout) {
     ensure_not_built( );
     if (timeout.count( ) <= 0)
         throw std::invalid_argument("Timeout must be +ve");
-    _request->_connect_timeout = timeout;
+    _request->common( ).connect_timeout = timeout;
     return *this;
 }
 
@@ -155,51 +348,55 @@ HttpRequestBuilder& HttpRequestBuilder::set_read_timeout(Timeout timeout) {
     ensure_not_built( );
     if (timeout.count( ) <= 0)
         throw std::invalid_argument("Timeout must be +ve");
-    _request->_read_timeout = timeout;
+    _request->common( ).read_timeout = timeout;
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::set_basic_auth(
-    const std::string& username, const std::string& password) {
+    std::string_view username, std::string_view password) {
     ensure_not_built( );
-    _request->_auth_config.type     = AuthType::BASIC;
-    _request->_auth_config.username = username;
-    _request->_auth_config.password = password;
+    auto& auth    = _request->common( ).auth_config;
+    auth.type     = AuthType::BASIC;
+    auth.username = username;
+    auth.password = password;
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::set_bearer_token(
-    const std::string& token) {
+    std::string_view token) {
     ensure_not_built( );
-    _request->_auth_config.type  = AuthType::BEARER;
-    _request->_auth_config.token = token;
+    auto& auth = _request->common( ).auth_config;
+    auth.type  = AuthType::BEARER;
+    auth.token = token;
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::set_api_key(
-    const std::string& api_key, const std::string& header_name) {
+    std::string_view api_key, std::string_view header_name) {
     ensure_not_built( );
-    _request->_auth_config.type           = AuthType::API_KEY;
-    _request->_auth_config.api_key        = api_key;
-    _request->_auth_config.api_key_header = header_name;
+    auto& auth          = _request->common( ).auth_config;
+    auth.type           = AuthType::API_KEY;
+    auth.api_key        = api_key;
+    auth.api_key_header = header_name;
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::set_follow_redirects(
     bool follow, int max_redirects) {
     ensure_not_built( );
-    _request->_follow_redirects = follow;
-    _request->_max_redirects    = max_redirects;
+    auto& common            = _request->common( );
+    common.follow_redirects = follow;
+    common.max_redirects    = max_redirects;
     return *this;
 }
 
 HttpRequestBuilder& HttpRequestBuilder::set_verify_ssl(bool verify) {
     ensure_not_built( );
-    _request->_verify_ssl = verify;
+    _request->common( ).verify_ssl = verify;
     return *this;
 }
 
-std::unique_ptr<HttpRequest> HttpRequestBuilder::build( ) {
+HttpRequestPtr HttpRequestBuilder::build( ) {
     ensure_not_built( );
     apply_authentication( );
     validate_request( );
@@ -210,22 +407,32 @@ std::unique_ptr<HttpRequest> HttpRequestBuilder::build( ) {
 }
 
 void HttpRequestBuilder::apply_authentication( ) {
-    switch (_request->_auth_config.type) {
+    const auto&      auth = _request->get_auth_config( );
+    std::pmr::string value(_request->get_allocator( ));
+
+    switch (auth.type) {
         case AuthType::BASIC: {
-            std::string auth_value = "Basic " +
-                                     _request->_auth_config.username + ":" +
-                                     _request->_auth_config.password;
-            _request->_headers["Authorization"] = auth_value;
+            std::pmr::string credentials(_request->get_allocator( ));
+            credentials.reserve(auth.username.size( ) + 1 +
+                                auth.password.size( ));
+            credentials.append(auth.username).append(1, ':');
+            credentials.append(auth.password);
+
+            value.reserve(6 + base64_encoded_size(credentials.size( )));
+            value.append("Basic ");
+            append_base64(value, credentials);
+            set_header(HeaderName::AUTHORIZATION, std::move(value));
             break;
         }
         case AuthType::BEARER: {
-            _request->_headers["Authorization"] =
-                "Bearer " + _request->_auth_config.token;
+            value.reserve(7 + auth.token.size( ));
+            value.append("Bearer ").append(auth.token);
+            set_header(HeaderName::AUTHORIZATION, std::move(value));
             break;
         }
         case AuthType::API_KEY: {
-            _request->_headers[_request->_auth_config.api_key_header] =
-                _request->_auth_config.api_key;
+            value.assign(auth.api_key);
+            set_header(auth.api_key_header, std::move(value));
             break;
         }
         case AuthType::NONE:
@@ -239,8 +446,8 @@ void HttpRequestBuilder::validate_request( ) const {
             case HttpMethod::POST:
             case HttpMethod::PUT:
             case HttpMethod::PATCH:
-                if (_request->_headers.find("Content-Type") ==
-                    _request->_headers.end( )) {
+                if (!_request->get_headers( ).contains(
+                        HeaderName::CONTENT_TYPE)) {
                     throw std::runtime_error(
                         "POST/PUT/PATCH requests with body must have "
                         "'Content-Type' header");
@@ -252,10 +459,10 @@ void HttpRequestBuilder::validate_request( ) const {
     }
 }
 
-std::unique_ptr<HttpRequest> HttpRequestDirector::build_json_api_request(
-    const std::string& url, HttpMethod method, const std::string& json_body,
-    const std::string& api_key) {
-    HttpRequestBuilder builder(url, method);
+HttpRequestPtr HttpRequestDirector::build_json_api_request(
+    std::string_view url, HttpMethod method, std::string_view json_body,
+    std::string_view api_key, std::pmr::memory_resource* resource) {
+    HttpRequestBuilder builder(url, method, resource);
 
     builder.add_header("Accept", "application/json")
         .add_header("User-Agent", "HttpClient/1.0");
@@ -267,17 +474,19 @@ std::unique_ptr<HttpRequest> HttpRequestDirector::build_json_api_request(
     return builder.build( );
 }
 
-std::unique_ptr<HttpRequest> HttpRequestDirector::build_form_request(
-    const std::string& url, const QueryParams& form_data) {
-    return HttpRequestBuilder(url, HttpMethod::POST)
+HttpRequestPtr HttpRequestDirector::build_form_request(
+    std::string_view url, const QueryParams& form_data,
+    std::pmr::memory_resource* resource) {
+    return HttpRequestBuilder(url, HttpMethod::POST, resource)
         .set_form_body(form_data)
         .add_header("User-Agent", "HttpClient/1.0")
         .build( );
 }
 
-std::unique_ptr<HttpRequest> HttpRequestDirector::build_download_request(
-    const std::string& url, const std::string& auth_token) {
-    HttpRequestBuilder builder(url, HttpMethod::GET);
+HttpRequestPtr HttpRequestDirector::build_download_request(
+    std::string_view url, std::string_view auth_token,
+    std::pmr::memory_resource* resource) {
+    HttpRequestBuilder builder(url, HttpMethod::GET, resource);
 
     builder.set_read_timeout(std::chrono::minutes(10))
         .set_follow_redirects(true)
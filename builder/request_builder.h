@@ -2,61 +2,185 @@
 #define REQUEST_BUILDER_H
 
 #include <chrono>
+#include <concepts>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "http_headers.h"
+#include "request_body.h"
 
 class HttpRequest;
 class HttpRequestBuilder;
+class HttpRequestPool;
 
-using Headers     = std::unordered_map<std::string, std::string>;
-using QueryParams = std::unordered_map<std::string, std::string>;
-using Timeout     = std::chrono::milliseconds;
+using QueryParams =
+    std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+using Timeout = std::chrono::milliseconds;
 
 enum class HttpMethod { GET, POST, PUT, DELETE, PATCH, HEAD, OPTIONS };
 
 enum class AuthType { NONE, BASIC, BEARER, API_KEY };
 
+template <HttpMethod Method, bool HasBody, bool HasContentType>
+class StaticRequestBuilder;
+
 struct AuthConfig {
-    AuthType    type = AuthType::NONE;
-    std::string username;
-    std::string password;
-    std::string token;
-    std::string api_key;
-    std::string api_key_header = "X-API-Key";
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    AuthType         type = AuthType::NONE;
+    std::pmr::string username;
+    std::pmr::string password;
+    std::pmr::string token;
+    std::pmr::string api_key;
+    std::pmr::string api_key_header;
+
+    explicit AuthConfig(allocator_type alloc = { })
+        : username(alloc),
+          password(alloc),
+          token(alloc),
+          api_key(alloc),
+          api_key_header("X-API-Key", alloc) {}
+
+    AuthConfig(const AuthConfig& other, allocator_type alloc)
+        : type(other.type),
+          username(other.username, alloc),
+          password(other.password, alloc),
+          token(other.token, alloc),
+          api_key(other.api_key, alloc),
+          api_key_header(other.api_key_header, alloc) {}
+
+    AuthConfig(const AuthConfig&)            = default;
+    AuthConfig& operator=(const AuthConfig&) = default;
+};
+
+/**
+ * The parts of a request that fan-out batches have in common: headers, auth
+ * and transfer settings.
+ *
+ * Shared copy-on-write between requests -- a copy of a request (batch, template
+ * instantiation) points at the same RequestCommon until one of them changes
+ * it. Only shared between requests on the same memory resource.
+ */
+struct RequestCommon {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    Headers    headers;
+    AuthConfig auth_config;
+    Timeout    connect_timeout  = Timeout(5000);
+    Timeout    read_timeout     = Timeout(30000);
+    bool       follow_redirects = true;
+    int        max_redirects    = 5;
+    bool       verify_ssl       = true;
+
+    explicit RequestCommon(allocator_type alloc = { })
+        : headers(alloc), auth_config(alloc) {}
+
+    RequestCommon(const RequestCommon& other, allocator_type alloc)
+        : headers(other.headers, alloc),
+          auth_config(other.auth_config, alloc),
+          connect_timeout(other.connect_timeout),
+          read_timeout(other.read_timeout),
+          follow_redirects(other.follow_redirects),
+          max_redirects(other.max_redirects),
+          verify_ssl(other.verify_ssl) {}
+
+    // back to the defaults, keeping allocated capacity
+    void reset( );
 };
 
+/**
+ * Releases a request the way it was obtained -- back to its pool, or through
+ * the memory resource it was allocated from.
+ */
+struct HttpRequestDeleter {
+    std::pmr::memory_resource* resource = nullptr;
+    HttpRequestPool*           pool     = nullptr;
+
+    void operator()(HttpRequest* request) const;
+};
+
+using HttpRequestPtr = std::unique_ptr<HttpRequest, HttpRequestDeleter>;
+
 /**
  * The request
+ *
+ * Allocator-aware: the request and every string / container it owns come from
+ * one std::pmr::memory_resource, so a request built on a stack arena does not
+ * touch the heap.
  */
 class HttpRequest {
-    std::string _url;
-    HttpMethod  _method;
-    Headers     _headers;
-    QueryParams _query_params;
-    std::string _body;
-    Timeout     _connect_timeout;
-    Timeout     _read_timeout;
-    AuthConfig  _auth_config;
-    bool        _follow_redirects;
-    int         _max_redirects;
-    bool        _verify_ssl;
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+private:
+    std::pmr::string               _url;
+    HttpMethod                     _method;
+    QueryParams                    _query_params;
+    RequestBody                    _body;
+    std::shared_ptr<RequestCommon> _common;
 
     friend class HttpRequestBuilder;
+    friend class HttpRequestPool;
+    friend class RequestTemplate;
+    friend class HttpRequestBatch;
+
+    template <HttpMethod Method, bool HasBody, bool HasContentType>
+    friend class StaticRequestBuilder;
+
+    HttpRequest(std::string_view url, HttpMethod method,
+                allocator_type alloc = { });
+    HttpRequest(const HttpRequest& other, allocator_type alloc);
 
-    HttpRequest(const std::string& url, HttpMethod method);
+    // a request allocated from, and released back to, `resource`
+    template <typename... Args>
+    static HttpRequestPtr create(std::pmr::memory_resource* resource,
+                                 Args&&... args) {
+        void* memory =
+            resource->allocate(sizeof(HttpRequest), alignof(HttpRequest));
+        try {
+            return HttpRequestPtr(
+                new (memory) HttpRequest(std::forward<Args>(args)..., resource),
+                HttpRequestDeleter{resource, nullptr});
+        } catch (...) {
+            resource->deallocate(memory, sizeof(HttpRequest),
+                                 alignof(HttpRequest));
+            throw;
+        }
+    }
+
+    // back to the freshly-constructed state, keeping allocated capacity
+    void reset(std::string_view url, HttpMethod method);
+
+    // the common parts, for writing -- copied first if they are shared
+    RequestCommon& common( );
 
 public:
     // simple getters -- may not need them
-    const std::string& get_url( ) const { return _url; }
+    std::string_view   get_url( ) const { return _url; }
     HttpMethod         get_method( ) const { return _method; }
-    const Headers&     get_headers( ) const { return _headers; }
+    const Headers&     get_headers( ) const { return _common->headers; }
+    // stored percent-encoded, as they go on the wire
     const QueryParams& get_query_params( ) const { return _query_params; }
-    const std::string& get_body( ) const { return _body; }
-    Timeout            get_connect_timeout( ) const { return _connect_timeout; }
-    Timeout            get_read_timeout( ) const { return _read_timeout; }
-    const AuthConfig&  get_auth_config( ) const { return _auth_config; }
-    bool should_follow_redirects( ) const { return _follow_redirects; }
-    int  get_max_redirects( ) const { return _max_redirects; }
-    bool should_verify_ssl( ) const { return _verify_ssl; }
+    const RequestBody& get_body( ) const { return _body; }
+    Timeout get_connect_timeout( ) const { return _common->connect_timeout; }
+    Timeout get_read_timeout( ) const { return _common->read_timeout; }
+    const AuthConfig& get_auth_config( ) const { return _common->auth_config; }
+    bool should_follow_redirects( ) const { return _common->follow_redirects; }
+    int  get_max_redirects( ) const { return _common->max_redirects; }
+    bool should_verify_ssl( ) const { return _common->verify_ssl; }
+
+    // whether the common parts are shared with other requests
+    bool shares_common_with(const HttpRequest& other) const {
+        return _common == other._common;
+    }
+
+    allocator_type get_allocator( ) const { return _url.get_allocator( ); }
 
     // builds the final URL with query params
     std::string build_full_url( ) const;
@@ -68,47 +192,146 @@ public:
     std::string to_string( ) const;
 };
 
+/**
+ * Recycles requests for a builder-heavy thread.
+ *
+ * A released request goes back on a free list with its strings and containers
+ * keeping their capacity, and everything is allocated from the pool's own
+ * unsynchronized_pool_resource -- so once warmed up, building a request of a
+ * familiar shape does not touch the global heap.
+ *
+ * Not thread-safe: use one pool per thread, and keep it alive for as long as
+ * any request obtained from it.
+ */
+class HttpRequestPool {
+public:
+    explicit HttpRequestPool(size_t                     max_idle = 64,
+                             std::pmr::memory_resource* upstream =
+                                 std::pmr::get_default_resource( ));
+    ~HttpRequestPool( );
+
+    HttpRequestPool(const HttpRequestPool&)            = delete;
+    HttpRequestPool& operator=(const HttpRequestPool&) = delete;
+
+    size_t idle( ) const { return _free.size( ); }
+
+private:
+    friend class HttpRequestBuilder;
+    friend struct HttpRequestDeleter;
+
+    template <HttpMethod Method, bool HasBody, bool HasContentType>
+    friend class StaticRequestBuilder;
+
+    std::pmr::unsynchronized_pool_resource _resource;
+    std::pmr::vector<HttpRequest*>         _free;
+    size_t                                 _max_idle;
+
+    HttpRequestPtr acquire(std::string_view url, HttpMethod method);
+    void           release(HttpRequest* request);
+};
+
+// only a std::pmr::string rvalue -- keeps the moving overloads below from
+// competing with the std::string_view ones for literals and lvalues
+template <typename T>
+concept PmrStringRvalue = std::same_as<T, std::pmr::string>;
+
 /**
  * The builder
  */
 class HttpRequestBuilder {
-    std::unique_ptr<HttpRequest> _request;
-    bool                         _built = false;
+    HttpRequestPtr _request;
+    bool           _built = false;
 
     void ensure_not_built( ) const;
-    void validate_url(const std::string& url) const;
+    void validate_url(std::string_view url) const;
     void apply_authentication( );
     void validate_request( ) const;
 
+    void set_header(std::string_view key, std::pmr::string&& value);
+    void set_header(HeaderName id, std::pmr::string&& value);
+    void set_query_param(std::string_view key, std::pmr::string&& value);
+
 public:
-    HttpRequestBuilder(const std::string& url, HttpMethod method);
+    // the request and all its strings are allocated from `resource`
+    HttpRequestBuilder(std::string_view url, HttpMethod method,
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource( ));
+
+    // the request is taken from (and later returned to) `pool`
+    HttpRequestBuilder(std::string_view url, HttpMethod method,
+                       HttpRequestPool& pool);
 
     // **fluent** interface methods for building the request
-    HttpRequestBuilder& add_header(const std::string& key,
-                                   const std::string& value);
+    HttpRequestBuilder& add_header(std::string_view key,
+                                   std::string_view value);
     HttpRequestBuilder& add_headers(const Headers& headers);
-    HttpRequestBuilder& add_query_param(const std::string& key,
-                                        const std::string& value);
+    // keys and values are given raw, and percent-encoded here
+    HttpRequestBuilder& add_query_param(std::string_view key,
+                                        std::string_view value);
     HttpRequestBuilder& add_query_params(const QueryParams& params);
-    HttpRequestBuilder& set_body(const std::string& body);
-    HttpRequestBuilder& set_json_body(const std::string& json);
+    HttpRequestBuilder& set_body(std::string_view body);
+    HttpRequestBuilder& set_json_body(std::string_view json);
     HttpRequestBuilder& set_form_body(const QueryParams& form_data);
+
+    // bodies that are not copied in: the caller's bytes (which must outlive
+    // the request), a memory-mapped file, or a generator callback
+    HttpRequestBuilder& borrow_body(std::string_view body,
+                                    std::string_view content_type);
+    HttpRequestBuilder& set_file_body(
+        const std::string& path,
+        std::string_view   content_type = "application/octet-stream");
+    HttpRequestBuilder& set_generated_body(
+        RequestBody::Generator generator,
+        size_t                 length       = RequestBody::UNKNOWN_LENGTH,
+        std::string_view       content_type = "application/octet-stream");
     HttpRequestBuilder& set_connect_timeout(Timeout timeout);
     HttpRequestBuilder& set_read_timeout(Timeout timeout);
-    HttpRequestBuilder& set_basic_auth(const std::string& username,
-                                       const std::string& password);
-    HttpRequestBuilder& set_bearer_token(const std::string& token);
-    HttpRequestBuilder& set_api_key(
-        const std::string& api_key,
-        const std::string& header_name = "X-API-Key");
+    HttpRequestBuilder& set_basic_auth(std::string_view username,
+                                       std::string_view password);
+    HttpRequestBuilder& set_bearer_token(std::string_view token);
+    HttpRequestBuilder& set_api_key(std::string_view api_key,
+                                    std::string_view header_name = "X-API-Key");
     HttpRequestBuilder& set_follow_redirects(bool follow,
                                              int  max_redirects = 5);
     HttpRequestBuilder& set_verify_ssl(bool verify);
 
+    // moving overloads -- the buffer is stolen when it was allocated from the
+    // request's memory resource, and copied otherwise
+    template <PmrStringRvalue S>
+    HttpRequestBuilder& add_header(std::string_view key, S&& value) {
+        ensure_not_built( );
+        set_header(key, std::move(value));
+        return *this;
+    }
+
+    template <PmrStringRvalue S>
+    HttpRequestBuilder& add_query_param(std::string_view key, S&& value) {
+        ensure_not_built( );
+        set_query_param(key, std::move(value));
+        return *this;
+    }
+
+    template <PmrStringRvalue S>
+    HttpRequestBuilder& set_body(S&& body) {
+        ensure_not_built( );
+        _request->_body.assign(std::move(body));
+        return *this;
+    }
+
+    template <PmrStringRvalue S>
+    HttpRequestBuilder& set_json_body(S&& json) {
+        ensure_not_built( );
+        _request->_body.assign(std::move(json));
+        set_header(HeaderName::CONTENT_TYPE,
+                   std::pmr::string("application/json",
+                                    _request->get_allocator( )));
+        return *this;
+    }
+
     /**
      * final request is built here
      */
-    std::unique_ptr<HttpRequest> build( );
+    HttpRequestPtr build( );
 };
 
 /**
@@ -122,21 +345,27 @@ public:
     /**
      * build a "standard" JSON API request
      */
-    static std::unique_ptr<HttpRequest> build_json_api_request(
-        const std::string& url, HttpMethod method,
-        const std::string& json_body = "", const std::string& api_key = "");
+    static HttpRequestPtr build_json_api_request(
+        std::string_view url, HttpMethod method,
+        std::string_view json_body = "", std::string_view api_key = "",
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource( ));
 
     /**
      * build a form submit request
      */
-    static std::unique_ptr<HttpRequest> build_form_request(
-        const std::string& url, const QueryParams& form_data);
+    static HttpRequestPtr build_form_request(
+        std::string_view url, const QueryParams& form_data,
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource( ));
 
     /**
      * build a file download request
      */
-    static std::unique_ptr<HttpRequest> build_download_request(
-        const std::string& url, const std::string& auth_token = "");
+    static HttpRequestPtr build_download_request(
+        std::string_view url, std::string_view auth_token = "",
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource( ));
 };
 
 #endif  // REQUEST_BUILDER_H
@@ -0,0 +1,225 @@
+#include "request_template.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "wire_format.h"
+
+namespace {
+
+bool is_slot_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+struct Placeholder {
+    std::string_view token;  // as it appears in the text
+    std::string_view name;
+};
+
+// a "{name}" at text[pos] -- or "%7Bname%7D", as the builder percent-encodes
+// query keys and values -- or an empty token
+Placeholder placeholder_at(std::string_view text, size_t pos) {
+    auto brace = [text](size_t at, char c) -> size_t {
+        if (at < text.size( ) && text[at] == c) return 1;
+        if (text.substr(at, 3) == (c == '{' ? "%7B" : "%7D")) return 3;
+        return 0;
+    };
+
+    size_t open = brace(pos, '{');
+    if (open == 0) return { };
+
+    size_t end = pos + open;
+    while (end < text.size( ) && is_slot_char(text[end])) ++end;
+    size_t close = brace(end, '}');
+    if (end == pos + open || close == 0) return { };
+
+    return {text.substr(pos, end + close - pos),
+            text.substr(pos + open, end - pos - open)};
+}
+
+// where a placeholder may start
+size_t find_placeholder(std::string_view text, size_t from = 0) {
+    return text.find_first_of("{%", from);
+}
+
+bool has_placeholder(std::string_view text) {
+    return find_placeholder(text) != std::string_view::npos;
+}
+
+bool expects_body(HttpMethod method) {
+    return method == HttpMethod::POST || method == HttpMethod::PUT ||
+           method == HttpMethod::PATCH;
+}
+
+}  // namespace
+
+RequestTemplate::RequestTemplate(HttpRequestPtr prototype)
+    : _prototype(std::move(prototype)), _method(_prototype->get_method( )) {
+    WireRequest wire;
+    wire.append_head(*_prototype);
+    _head = wire.to_string( );
+
+    uint32_t literal_start = 0;
+    for (size_t pos = find_placeholder(_head); pos != std::string::npos;
+         pos        = find_placeholder(_head, pos + 1)) {
+        auto [placeholder, name] = placeholder_at(_head, pos);
+        if (placeholder.empty( )) continue;
+
+        auto slot = _slot_names.size( );
+        for (size_t i = 0; i < _slot_names.size( ); ++i) {
+            if (_slot_names[i] == name) slot = i;
+        }
+        if (slot == _slot_names.size( )) {
+            if (slot == MAX_SLOTS)
+                throw std::invalid_argument("Too many template placeholders");
+            _slot_names.emplace_back(name);
+        }
+
+        _pieces.push_back({literal_start,
+                           static_cast<uint32_t>(pos) - literal_start,
+                           static_cast<uint16_t>(slot)});
+        literal_start = static_cast<uint32_t>(pos + placeholder.size( ));
+        pos           = literal_start - 1;
+    }
+    _pieces.push_back({literal_start,
+                       static_cast<uint32_t>(_head.size( )) - literal_start,
+                       NO_SLOT});
+}
+
+RequestTemplate RequestTemplate::json_api(std::string_view url,
+                                          HttpMethod       method,
+                                          std::string_view api_key) {
+    // a placeholder body, so that Content-Type is set
+    return RequestTemplate(HttpRequestDirector::build_json_api_request(
+        url, method, expects_body(method) ? "{}" : "", api_key));
+}
+
+RequestTemplate RequestTemplate::download(std::string_view url,
+                                          std::string_view auth_token) {
+    return RequestTemplate(
+        HttpRequestDirector::build_download_request(url, auth_token));
+}
+
+size_t RequestTemplate::slot(std::string_view name) const {
+    for (size_t i = 0; i < _slot_names.size( ); ++i) {
+        if (_slot_names[i] == name) return i;
+    }
+    throw std::invalid_argument("Template has no placeholder '" +
+                                std::string(name) + "'");
+}
+
+void RequestTemplate::check_arguments(
+    const TemplateArguments& arguments) const {
+    if (arguments._template != this)
+        throw std::invalid_argument("Arguments belong to another template");
+
+    for (size_t i = 0; i < _slot_names.size( ); ++i) {
+        if (!arguments.is_bound(i))
+            throw std::invalid_argument("Template placeholder '" +
+                                        _slot_names[i] + "' is not bound");
+    }
+}
+
+void RequestTemplate::substitute(std::pmr::string&        text,
+                                 const TemplateArguments& arguments) const {
+    if (!has_placeholder(text)) return;
+
+    std::pmr::string result(text.get_allocator( ));
+    result.reserve(text.size( ));
+
+    std::string_view source = text;
+    size_t           copied = 0;
+    for (size_t pos = find_placeholder(source); pos != std::string_view::npos;
+         pos        = find_placeholder(source, pos + 1)) {
+        auto [placeholder, name] = placeholder_at(source, pos);
+        if (placeholder.empty( )) continue;
+
+        for (size_t i = 0; i < _slot_names.size( ); ++i) {
+            if (_slot_names[i] != name) continue;
+            result.append(source.substr(copied, pos - copied));
+            result.append(arguments.get(i));
+            copied = pos + placeholder.size( );
+            break;
+        }
+    }
+    result.append(source.substr(copied));
+    text = std::move(result);
+}
+
+HttpRequestPtr RequestTemplate::instantiate(
+    const TemplateArguments&   arguments,
+    std::pmr::memory_resource* resource) const {
+    check_arguments(arguments);
+
+    auto request = HttpRequest::create(resource, *_prototype);
+
+    substitute(request->_url, arguments);
+
+    // map keys are const: params with a placeholder in the key are taken out,
+    // and put back under the substituted key
+    auto&                               params = request->_query_params;
+    std::vector<QueryParams::node_type> renamed;
+    for (auto it = params.begin( ); it != params.end( );) {
+        substitute(it->second, arguments);
+        if (has_placeholder(it->first))
+            renamed.push_back(params.extract(it++));
+        else
+            ++it;
+    }
+    for (auto& node : renamed) {
+        substitute(node.key( ), arguments);
+        auto inserted = params.insert(std::move(node));
+        if (!inserted.inserted)
+            inserted.position->second = std::move(inserted.node.mapped( ));
+    }
+
+    // headers and auth stay shared with the prototype unless they hold a
+    // placeholder
+    for (const auto& header : _prototype->get_headers( )) {
+        if (!has_placeholder(header.value)) continue;
+
+        std::pmr::string value(header.value, resource);
+        substitute(value, arguments);
+        if (header.id == HeaderName::CUSTOM)
+            request->common( ).headers.set(header.name( ), std::move(value));
+        else
+            request->common( ).headers.set(header.id, std::move(value));
+    }
+
+    const auto& auth = _prototype->get_auth_config( );
+    if (has_placeholder(auth.token) || has_placeholder(auth.api_key)) {
+        substitute(request->common( ).auth_config.token, arguments);
+        substitute(request->common( ).auth_config.api_key, arguments);
+    }
+    request->_body.assign(arguments.get_body( ));
+
+    return request;
+}
+
+TemplateArguments::TemplateArguments(const RequestTemplate& request_template)
+    : _template(&request_template),
+      _body(request_template.prototype( ).get_body( ).is_contiguous( )
+                ? request_template.prototype( ).get_body( ).view( )
+                : std::string_view{ }) {}
+
+TemplateArguments& TemplateArguments::set(size_t           slot,
+                                          std::string_view value) {
+    if (slot >= _template->slot_count( ))
+        throw std::out_of_range("Template slot out of range");
+
+    _values[slot] = value;
+    _bound |= 1u << slot;
+    return *this;
+}
+
+TemplateArguments& TemplateArguments::set(std::string_view name,
+                                          std::string_view value) {
+    return set(_template->slot(name), value);
+}
+
+TemplateArguments& TemplateArguments::set_body(std::string_view body) {
+    _body = body;
+    return *this;
+}
@@ -0,0 +1,119 @@
+#ifndef REQUEST_TEMPLATE_H
+#define REQUEST_TEMPLATE_H
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "request_builder.h"
+
+class TemplateArguments;
+
+/**
+ * A request recipe compiled once, for hot paths where only a few values change
+ * between calls.
+ *
+ * The prototype request is built the usual way (builder or director), with
+ * `{name}` placeholders where the values go -- in URL path segments, query
+ * keys and values, header values, or an auth token
+ * (`set_bearer_token("{token}")`).
+ * Compiling serializes its HTTP/1.1 head once and records where each
+ * placeholder sits. The body is always a slot of its own; the prototype's body
+ * is its default.
+ *
+ * Instantiating only patches the slots: WireRequest(template, arguments) emits
+ * iovecs over the precompiled head and the argument values -- no builder, no
+ * allocation, and no checks beyond rejecting line breaks in the values.
+ * instantiate() makes an HttpRequest instead, by copying the prototype and
+ * substituting the placeholders.
+ *
+ * Placeholders in query keys and values are found in their percent-encoded
+ * form too. Values are inserted as given -- encode them for where they go
+ * (append_url_encoded for path segments and query values). Basic auth cannot
+ * hold a placeholder, as its credentials are Base64-encoded at build time.
+ *
+ * Immutable once compiled, so one template can be shared between threads.
+ */
+class RequestTemplate {
+public:
+    static constexpr size_t   MAX_SLOTS = 16;
+    static constexpr uint16_t NO_SLOT   = UINT16_MAX;
+
+    // throws std::invalid_argument for more than MAX_SLOTS placeholder names
+    explicit RequestTemplate(HttpRequestPtr prototype);
+
+    // director recipes, compiled
+    static RequestTemplate json_api(std::string_view url, HttpMethod method,
+                                    std::string_view api_key = "");
+    static RequestTemplate download(std::string_view url,
+                                    std::string_view auth_token = "");
+
+    size_t           slot_count( ) const { return _slot_names.size( ); }
+    std::string_view slot_name(size_t slot) const { return _slot_names[slot]; }
+
+    // index of a placeholder, for binding it without a name lookup; throws
+    // std::invalid_argument if the template has no such placeholder
+    size_t slot(std::string_view name) const;
+
+    const HttpRequest& prototype( ) const { return *_prototype; }
+
+    // the prototype with the arguments substituted
+    HttpRequestPtr instantiate(const TemplateArguments&   arguments,
+                               std::pmr::memory_resource* resource =
+                                   std::pmr::get_default_resource( )) const;
+
+private:
+    friend class WireRequest;
+
+    // a literal run of the head, followed by a slot (or NO_SLOT)
+    struct Piece {
+        uint32_t offset;
+        uint32_t length;
+        uint16_t slot;
+    };
+
+    HttpRequestPtr           _prototype;
+    HttpMethod               _method;
+    std::string              _head;
+    std::vector<Piece>       _pieces;
+    std::vector<std::string> _slot_names;
+
+    // throws std::invalid_argument when the arguments are for another template
+    // or leave a slot unbound
+    void check_arguments(const TemplateArguments& arguments) const;
+
+    void substitute(std::pmr::string&        text,
+                    const TemplateArguments& arguments) const;
+};
+
+/**
+ * Values for one instantiation of a RequestTemplate.
+ *
+ * Holds views only: the strings must outlive the request made from it. Cheap
+ * to build per call; bind by index (RequestTemplate::slot) on hot paths.
+ */
+class TemplateArguments {
+public:
+    explicit TemplateArguments(const RequestTemplate& request_template);
+
+    TemplateArguments& set(size_t slot, std::string_view value);
+    TemplateArguments& set(std::string_view name, std::string_view value);
+    TemplateArguments& set_body(std::string_view body);
+
+    std::string_view get(size_t slot) const { return _values[slot]; }
+    std::string_view get_body( ) const { return _body; }
+    bool is_bound(size_t slot) const { return _bound & (1u << slot); }
+
+private:
+    friend class RequestTemplate;
+
+    const RequestTemplate*                                    _template;
+    std::array<std::string_view, RequestTemplate::MAX_SLOTS> _values{ };
+    std::string_view                                          _body;
+    uint32_t                                                  _bound = 0;
+};
+
+#endif  // REQUEST_TEMPLATE_H
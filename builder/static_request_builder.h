@@ -0,0 +1,263 @@
+#ifndef STATIC_REQUEST_BUILDER_H
+#define STATIC_REQUEST_BUILDER_H
+
+#include <chrono>
+#include <memory_resource>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "request_builder.h"
+#include "url_encoding.h"
+
+/**
+ * A URL known at compile time, checked there -- an invalid literal does not
+ * compile, where HttpRequestBuilder would throw at run time.
+ */
+struct StaticUrl {
+    std::string_view value;
+
+    consteval StaticUrl(const char* url) : value(url) {
+        std::string_view rest;
+        if (value.starts_with("http://"))
+            rest = value.substr(7);
+        else if (value.starts_with("https://"))
+            rest = value.substr(8);
+        else
+            throw "URL must start with http:// or https://";
+
+        if (rest.empty( ) || rest.front( ) == '/' || rest.front( ) == '?')
+            throw "URL has no host";
+        for (char c : value) {
+            if (c <= ' ' || c == 0x7F) throw "URL contains a space or control";
+        }
+    }
+};
+
+/**
+ * A header name known at compile time: checked to be a valid HTTP token and
+ * interned there. Content-Type and Content-Length are not accepted -- the
+ * first goes through content_type() / json_body() so that the builder can
+ * track it, and the second is computed on the wire.
+ */
+struct StaticHeaderName {
+    std::string_view name;
+    HeaderName       id;
+
+    consteval StaticHeaderName(const char* header_name)
+        : name(header_name), id(intern_header_name(header_name)) {
+        if (name.empty( )) throw "Header name cannot be empty";
+        for (char c : name) {
+            bool token = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c >= '0' && c <= '9') ||
+                         std::string_view("!#$%&'*+-.^_`|~").find(c) !=
+                             std::string_view::npos;
+            if (!token) throw "Header name is not an HTTP token";
+        }
+        if (id == HeaderName::CONTENT_TYPE)
+            throw "Use content_type() or json_body() to set Content-Type";
+        if (id == HeaderName::CONTENT_LENGTH)
+            throw "Content-Length is computed from the body";
+    }
+};
+
+// a timeout known at compile time, checked to be positive there
+struct StaticTimeout {
+    Timeout value;
+
+    template <typename Rep, typename Period>
+    consteval StaticTimeout(std::chrono::duration<Rep, Period> timeout)
+        : value(std::chrono::duration_cast<Timeout>(timeout)) {
+        if (value.count( ) <= 0) throw "Timeout must be +ve";
+    }
+};
+
+constexpr bool method_allows_body(HttpMethod method) {
+    return method == HttpMethod::POST || method == HttpMethod::PUT ||
+           method == HttpMethod::PATCH || method == HttpMethod::DELETE;
+}
+
+/**
+ * The typestate builder -- for requests whose shape is known at compile time
+ *
+ * The method, and whether a body and a Content-Type have been set, are part
+ * of the builder's type. Every setter consumes the builder (it is
+ * rvalue-qualified) and returns the builder for the next state, so the rules
+ * HttpRequestBuilder checks at run time are compile errors here:
+ *
+ *   - a body on a method that takes none (GET, HEAD, OPTIONS)
+ *   - a body without a Content-Type
+ *   - building an lvalue -- every setter, and build(), take an rvalue only
+ *   - a malformed URL or header name literal, or a timeout that is not +ve
+ *
+ * A request that compiles needs no validation, so build() just hands it over.
+ * A builder is empty once built: using it again (`std::move(b)` twice) is
+ * not caught by the compiler, and throws std::runtime_error instead.
+ * Dynamic requests (URL or header names from input) still go through
+ * HttpRequestBuilder.
+ *
+ *   auto request = StaticRequestBuilder<HttpMethod::POST>(
+ *                      "https://api.example.com/orders")
+ *                      .header("Accept", "application/json")
+ *                      .json_body(order_json)
+ *                      .build( );
+ */
+template <HttpMethod Method, bool HasBody = false, bool HasContentType = false>
+class StaticRequestBuilder {
+public:
+    explicit StaticRequestBuilder(StaticUrl                  url,
+                                  std::pmr::memory_resource* resource =
+                                      std::pmr::get_default_resource( ))
+        requires (!HasBody && !HasContentType)
+        : _request(HttpRequest::create(resource, url.value, Method)) {}
+
+    StaticRequestBuilder(StaticUrl url, HttpRequestPool& pool)
+        requires (!HasBody && !HasContentType)
+        : _request(pool.acquire(url.value, Method)) {}
+
+    StaticRequestBuilder(StaticRequestBuilder&&)            = default;
+    StaticRequestBuilder& operator=(StaticRequestBuilder&&) = default;
+
+    StaticRequestBuilder header(StaticHeaderName name,
+                                std::string_view value) && {
+        if (name.id == HeaderName::CUSTOM)
+            request( ).common( ).headers.set(name.name, value);
+        else
+            request( ).common( ).headers.set(name.id, value);
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder query_param(std::string_view key,
+                                     std::string_view value) && {
+        auto             alloc = request( ).get_allocator( );
+        std::pmr::string encoded_key(alloc);
+        std::pmr::string encoded_value(alloc);
+        append_url_encoded(encoded_key, key);
+        append_url_encoded(encoded_value, value);
+        request( )._query_params.insert_or_assign(std::move(encoded_key),
+                                                  std::move(encoded_value));
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder<Method, HasBody, true> content_type(
+        std::string_view type) && {
+        request( ).common( ).headers.set(HeaderName::CONTENT_TYPE, type);
+        return StaticRequestBuilder<Method, HasBody, true>(
+            std::move(_request));
+    }
+
+    StaticRequestBuilder<Method, true, HasContentType> body(
+        std::string_view body) && {
+        static_assert(method_allows_body(Method),
+                      "GET, HEAD and OPTIONS requests take no body");
+        request( )._body.assign(body);
+        return StaticRequestBuilder<Method, true, HasContentType>(
+            std::move(_request));
+    }
+
+    StaticRequestBuilder<Method, true, true> json_body(
+        std::string_view json) && {
+        static_assert(method_allows_body(Method),
+                      "GET, HEAD and OPTIONS requests take no body");
+        request( )._body.assign(json);
+        request( ).common( ).headers.set(HeaderName::CONTENT_TYPE,
+                                         std::string_view("application/json"));
+        return StaticRequestBuilder<Method, true, true>(std::move(_request));
+    }
+
+    StaticRequestBuilder connect_timeout(StaticTimeout timeout) && {
+        request( ).common( ).connect_timeout = timeout.value;
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder read_timeout(StaticTimeout timeout) && {
+        request( ).common( ).read_timeout = timeout.value;
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder bearer_token(std::string_view token) && {
+        auto& auth = request( ).common( ).auth_config;
+        auth.type  = AuthType::BEARER;
+        auth.token.assign(token);
+
+        std::pmr::string value(request( ).get_allocator( ));
+        value.reserve(7 + token.size( ));
+        value.append("Bearer ").append(token);
+        request( ).common( ).headers.set(HeaderName::AUTHORIZATION,
+                                         std::move(value));
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder basic_auth(std::string_view username,
+                                    std::string_view password) && {
+        auto& auth = request( ).common( ).auth_config;
+        auth.type  = AuthType::BASIC;
+        auth.username.assign(username);
+        auth.password.assign(password);
+
+        std::pmr::string credentials(request( ).get_allocator( ));
+        credentials.reserve(username.size( ) + 1 + password.size( ));
+        credentials.append(username).append(1, ':').append(password);
+
+        std::pmr::string value(request( ).get_allocator( ));
+        value.reserve(6 + base64_encoded_size(credentials.size( )));
+        value.append("Basic ");
+        append_base64(value, credentials);
+        request( ).common( ).headers.set(HeaderName::AUTHORIZATION,
+                                         std::move(value));
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder api_key(
+        std::string_view key, StaticHeaderName header = "X-API-Key") && {
+        auto& auth = request( ).common( ).auth_config;
+        auth.type  = AuthType::API_KEY;
+        auth.api_key.assign(key);
+        auth.api_key_header.assign(header.name);
+        return std::move(*this).header(header, key);
+    }
+
+    StaticRequestBuilder follow_redirects(bool follow,
+                                          int  max_redirects = 5) && {
+        auto& common            = request( ).common( );
+        common.follow_redirects = follow;
+        common.max_redirects    = max_redirects;
+        return std::move(*this);
+    }
+
+    StaticRequestBuilder verify_ssl(bool verify) && {
+        request( ).common( ).verify_ssl = verify;
+        return std::move(*this);
+    }
+
+    /**
+     * final request -- nothing left to validate
+     */
+    HttpRequestPtr build( ) && {
+        static_assert(!HasBody || HasContentType,
+                      "A request with a body needs a Content-Type: call "
+                      "content_type() or json_body()");
+        request( );
+        return std::move(_request);
+    }
+
+private:
+    template <HttpMethod, bool, bool>
+    friend class StaticRequestBuilder;
+
+    HttpRequestPtr _request;
+
+    explicit StaticRequestBuilder(HttpRequestPtr request)
+        : _request(std::move(request)) {}
+
+    // the request being built; the builder was moved from or built otherwise
+    HttpRequest& request( ) {
+        if (!_request)
+            throw std::runtime_error(
+                "Request has already been built. Create a new builder for a "
+                "new request");
+        return *_request;
+    }
+};
+
+#endif  // STATIC_REQUEST_BUILDER_H
@@ -0,0 +1,199 @@
+#include "url_encoding.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define URL_ENCODING_HAS_SSSE3 1
+#endif
+
+namespace {
+
+constexpr char hex_digits[]    = "0123456789ABCDEF";
+constexpr char base64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr bool is_unreserved(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+           c == '~';
+}
+
+#if defined(__SSE2__)
+// bit i set when in[i] is unreserved
+int unreserved_mask(__m128i in) {
+    // bytes >= 0x80 compare as negative, so they fail every range check
+    __m128i lower = _mm_or_si128(in, _mm_set1_epi8(0x20));
+    __m128i alpha =
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                      _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), in));
+    __m128i mark  = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('-')),
+                     _mm_cmpeq_epi8(in, _mm_set1_epi8('.'))),
+        _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('_')),
+                     _mm_cmpeq_epi8(in, _mm_set1_epi8('~'))));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), mark));
+}
+#endif
+
+#if URL_ENCODING_HAS_SSSE3
+// 12 input bytes -> 16 Base64 digits per step (Mula / Lemire): spread the
+// 6-bit groups into bytes with a shuffle and two multiplies, then map each
+// group to its digit by adding an offset looked up per range
+__attribute__((target("ssse3"))) void base64_encode_ssse3(std::string_view in,
+                                                          char* out) {
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4,
+                                        1, 2, 0, 1);
+    const __m128i offsets =
+        _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                      '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    // 16-byte loads, of which 12 bytes are used
+    for (; i + 16 <= in.size( ); i += 12, out += 16) {
+        __m128i bytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(in.data( ) + i));
+        bytes = _mm_shuffle_epi8(bytes, spread);
+
+        __m128i hi = _mm_mulhi_epu16(
+            _mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)),
+            _mm_set1_epi32(0x04000040));
+        __m128i lo = _mm_mullo_epi16(
+            _mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)),
+            _mm_set1_epi32(0x01000010));
+        __m128i groups = _mm_or_si128(hi, lo);
+
+        // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+        __m128i range = _mm_subs_epu8(groups, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), groups);
+        range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+        __m128i digits =
+            _mm_add_epi8(groups, _mm_shuffle_epi8(offsets, range));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), digits);
+    }
+
+    base64_encode_scalar(in.substr(i), out);
+}
+
+using Base64Encoder = void (*)(std::string_view, char*);
+
+// resolved on first use, so it is safe from other static initializers
+Base64Encoder base64_encoder( ) {
+    static const Base64Encoder encoder = [] {
+        __builtin_cpu_init( );
+        return __builtin_cpu_supports("ssse3") ? base64_encode_ssse3
+                                               : base64_encode_scalar;
+    }( );
+    return encoder;
+}
+#endif
+
+}  // namespace
+
+size_t find_url_unsafe_scalar(std::string_view in, UrlEncoding encoding) {
+    // both encodings escape the same bytes; they differ only in how a space
+    // is written, which append_url_encoded decides
+    (void)encoding;
+    for (size_t i = 0; i < in.size( ); ++i) {
+        if (!is_unreserved(static_cast<unsigned char>(in[i]))) return i;
+    }
+    return in.size( );
+}
+
+size_t find_url_unsafe(std::string_view in, UrlEncoding encoding) {
+#if defined(__SSE2__)
+    size_t i = 0;
+    for (; i + 16 <= in.size( ); i += 16) {
+        __m128i bytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(in.data( ) + i));
+        unsigned unsafe = ~static_cast<unsigned>(unreserved_mask(bytes)) &
+                          0xFFFFu;
+        if (unsafe) return i + __builtin_ctz(unsafe);
+    }
+    return i + find_url_unsafe_scalar(in.substr(i), encoding);
+#else
+    return find_url_unsafe_scalar(in, encoding);
+#endif
+}
+
+void append_url_encoded(std::pmr::string& out, std::string_view in,
+                        UrlEncoding encoding) {
+    size_t safe = find_url_unsafe(in, encoding);
+    if (safe == in.size( )) {
+        out.append(in);
+        return;
+    }
+
+    // room for the common case of a few escapes
+    out.reserve(out.size( ) + in.size( ) + 16);
+    while (!in.empty( )) {
+        out.append(in.substr(0, safe));
+        if (safe == in.size( )) break;
+
+        auto c = static_cast<unsigned char>(in[safe]);
+        if (c == ' ' && encoding == UrlEncoding::FORM) {
+            out.push_back('+');
+        } else {
+            char escaped[3] = {'%', hex_digits[c >> 4], hex_digits[c & 0xF]};
+            out.append(escaped, 3);
+        }
+
+        in.remove_prefix(safe + 1);
+        safe = find_url_unsafe(in, encoding);
+    }
+}
+
+void base64_encode_scalar(std::string_view in, char* out) {
+    auto   data = reinterpret_cast<const unsigned char*>(in.data( ));
+    size_t i    = 0;
+    for (; i + 3 <= in.size( ); i += 3, out += 4) {
+        uint32_t triple = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out[0]          = base64_digits[(triple >> 18) & 0x3F];
+        out[1]          = base64_digits[(triple >> 12) & 0x3F];
+        out[2]          = base64_digits[(triple >> 6) & 0x3F];
+        out[3]          = base64_digits[triple & 0x3F];
+    }
+
+    size_t rest = in.size( ) - i;
+    if (rest == 0) return;
+
+    uint32_t triple = data[i] << 16;
+    if (rest == 2) triple |= data[i + 1] << 8;
+    out[0] = base64_digits[(triple >> 18) & 0x3F];
+    out[1] = base64_digits[(triple >> 12) & 0x3F];
+    out[2] = rest == 2 ? base64_digits[(triple >> 6) & 0x3F] : '=';
+    out[3] = '=';
+}
+
+void base64_encode(std::string_view in, char* out) {
+#if URL_ENCODING_HAS_SSSE3
+    base64_encoder( )(in, out);
+#else
+    base64_encode_scalar(in, out);
+#endif
+}
+
+void append_base64(std::pmr::string& out, std::string_view in) {
+    size_t offset = out.size( );
+    out.resize(offset + base64_encoded_size(in.size( )));
+    base64_encode(in, out.data( ) + offset);
+}
+
+const char* url_encoding_simd_level( ) {
+#if URL_ENCODING_HAS_SSSE3
+    if (base64_encoder( ) != base64_encode_scalar) return "ssse3";
+#endif
+#if defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
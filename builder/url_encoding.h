@@ -0,0 +1,43 @@
+#ifndef URL_ENCODING_H
+#define URL_ENCODING_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+/**
+ * Encoders for what the builder puts on the wire: percent-encoding for query
+ * keys and values (RFC 3986 -- everything but unreserved characters is
+ * escaped), application/x-www-form-urlencoded bodies (the same, with space as
+ * '+'), and Base64 for Basic auth.
+ *
+ * Scanning for bytes to escape runs 16 at a time with SSE2, and Base64 uses
+ * SSSE3 when the CPU has it (checked once, at startup). Other targets use the
+ * scalar versions, which are also exposed for comparison.
+ */
+enum class UrlEncoding { COMPONENT, FORM };
+
+// index of the first byte that has to be escaped, or in.size( )
+size_t find_url_unsafe(std::string_view   in,
+                       UrlEncoding encoding = UrlEncoding::COMPONENT);
+
+void append_url_encoded(std::pmr::string& out, std::string_view in,
+                        UrlEncoding encoding = UrlEncoding::COMPONENT);
+
+constexpr size_t base64_encoded_size(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+// writes base64_encoded_size(in.size( )) bytes, padded with '='
+void base64_encode(std::string_view in, char* out);
+void append_base64(std::pmr::string& out, std::string_view in);
+
+// the widest instruction set in use: "ssse3", "sse2" or "scalar"
+const char* url_encoding_simd_level( );
+
+// scalar reference versions
+size_t find_url_unsafe_scalar(std::string_view in, UrlEncoding encoding);
+void   base64_encode_scalar(std::string_view in, char* out);
+
+#endif  // URL_ENCODING_H
@@ -0,0 +1,193 @@
+#include "wire_format.h"
+
+#include <charconv>
+#include <stdexcept>
+
+#include "request_template.h"
+
+namespace {
+
+std::string_view method_token(HttpMethod method) {
+    switch (method) {
+        case HttpMethod::GET:
+            return "GET ";
+        case HttpMethod::POST:
+            return "POST ";
+        case HttpMethod::PUT:
+            return "PUT ";
+        case HttpMethod::DELETE:
+            return "DELETE ";
+        case HttpMethod::PATCH:
+            return "PATCH ";
+        case HttpMethod::HEAD:
+            return "HEAD ";
+        case HttpMethod::OPTIONS:
+            return "OPTIONS ";
+    }
+    return "GET ";
+}
+
+bool expects_body(HttpMethod method) {
+    return method == HttpMethod::POST || method == HttpMethod::PUT ||
+           method == HttpMethod::PATCH;
+}
+
+// "https://user@host:8443/a/b?x=1#top" -> "host:8443" and "/a/b?x=1"
+struct UrlParts {
+    std::string_view authority;
+    std::string_view target;  // may be empty or start with '?'
+};
+
+UrlParts split_url(std::string_view url) {
+    auto scheme_end = url.find("://");
+    if (scheme_end == std::string_view::npos)
+        throw std::invalid_argument("URL has no scheme");
+    url.remove_prefix(scheme_end + 3);
+
+    url = url.substr(0, url.find('#'));
+
+    auto     authority_end = url.find_first_of("/?");
+    UrlParts parts;
+    parts.authority = url.substr(0, authority_end);
+    if (authority_end != std::string_view::npos)
+        parts.target = url.substr(authority_end);
+
+    auto at = parts.authority.rfind('@');
+    if (at != std::string_view::npos) parts.authority.remove_prefix(at + 1);
+    return parts;
+}
+
+using namespace std::string_view_literals;
+
+// CR, LF or NUL would end the line early -- a caller could smuggle in headers
+// or a second request; spaces would also split the request line
+constexpr auto LINE_BREAKS = "\r\n\0"sv;
+constexpr auto LINE_BREAKS_OR_SPACE = "\r\n\0 "sv;
+
+void check_wire_text(std::string_view text, std::string_view forbidden,
+                     const char* what) {
+    if (text.find_first_of(forbidden) != std::string_view::npos)
+        throw std::invalid_argument(std::string(what) +
+                                    " holds a character not allowed there");
+}
+
+}  // namespace
+
+void WireRequest::append(std::string_view bytes) {
+    if (bytes.empty( )) return;
+    if (_count == _segments.size( ))
+        throw std::length_error("request has too many parts for WireRequest");
+
+    // iovec is shared with readv, hence the non-const pointer; writev only
+    // reads through it
+    _segments[_count++] = {const_cast<char*>(bytes.data( )), bytes.size( )};
+    _bytes += bytes.size( );
+}
+
+void WireRequest::append_header(std::string_view name,
+                                std::string_view value) {
+    append(name);
+    append(": ");
+    append(value);
+    append("\r\n");
+}
+
+WireRequest::WireRequest(const HttpRequest& request) {
+    append_head(request);
+    append_body(request.get_method( ), request.get_body( ));
+}
+
+WireRequest::WireRequest(const RequestTemplate&   request_template,
+                         const TemplateArguments& arguments) {
+    request_template.check_arguments(arguments);
+
+    std::string_view head = request_template._head;
+    for (const auto& piece : request_template._pieces) {
+        append(head.substr(piece.offset, piece.length));
+        if (piece.slot == RequestTemplate::NO_SLOT) continue;
+        check_wire_text(arguments.get(piece.slot), LINE_BREAKS,
+                        "Template argument");
+        append(arguments.get(piece.slot));
+    }
+    append_body(request_template._method, arguments.get_body( ));
+}
+
+void WireRequest::append_head(const HttpRequest& request) {
+    auto url = split_url(request.get_url( ));
+
+    // request line
+    check_wire_text(url.authority, LINE_BREAKS_OR_SPACE, "URL host");
+    check_wire_text(url.target, LINE_BREAKS_OR_SPACE, "URL");
+    append(method_token(request.get_method( )));
+    if (url.target.empty( ) || url.target.front( ) == '?') append("/");
+    append(url.target);
+
+    bool has_query = url.target.find('?') != std::string_view::npos;
+    for (const auto& [key, value] : request.get_query_params( )) {
+        check_wire_text(key, LINE_BREAKS_OR_SPACE, "Query key");
+        check_wire_text(value, LINE_BREAKS_OR_SPACE, "Query value");
+        append(has_query ? "&" : "?");
+        append(key);
+        append("=");
+        append(value);
+        has_query = true;
+    }
+    append(" HTTP/1.1\r\n");
+
+    // headers
+    const auto& headers = request.get_headers( );
+    if (!headers.contains(HeaderName::HOST))
+        append_header(header_name_string(HeaderName::HOST), url.authority);
+
+    // framing is computed from the body in append_body
+    for (const auto& header : headers) {
+        if (header.id == HeaderName::CONTENT_LENGTH ||
+            header.id == HeaderName::TRANSFER_ENCODING)
+            continue;
+        check_wire_text(header.name( ), LINE_BREAKS_OR_SPACE, "Header name");
+        check_wire_text(header.value, LINE_BREAKS, "Header value");
+        append_header(header.name( ), header.value);
+    }
+}
+
+void WireRequest::append_content_length(size_t length) {
+    auto* begin = _content_length.data( );
+    auto  end =
+        std::to_chars(begin, begin + _content_length.size( ), length).ptr;
+    append_header(header_name_string(HeaderName::CONTENT_LENGTH),
+                  std::string_view(begin, end - begin));
+}
+
+void WireRequest::append_body(HttpMethod method, const RequestBody& body) {
+    if (body.is_contiguous( )) {
+        append_body(method, body.view( ));
+        return;
+    }
+
+    _streams_body = true;
+    if (body.has_known_length( )) {
+        append_content_length(body.length( ));
+    } else {
+        _chunked = true;
+        append_header(header_name_string(HeaderName::TRANSFER_ENCODING),
+                      "chunked");
+    }
+    append("\r\n");
+}
+
+void WireRequest::append_body(HttpMethod method, std::string_view body) {
+    if (!body.empty( ) || expects_body(method))
+        append_content_length(body.size( ));
+
+    append("\r\n");
+    append(body);
+}
+
+std::string WireRequest::to_string( ) const {
+    std::string wire;
+    wire.reserve(_bytes);
+    for (size_t i = 0; i < _count; ++i)
+        wire.append(static_cast<const char*>(_segments[i].iov_base),
+                    _segments[i].iov_len);
+    return wire;
+}
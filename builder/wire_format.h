@@ -0,0 +1,91 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <sys/uio.h>
+
+#include <array>
+#include <string>
+#include <string_view>
+
+#include "request_builder.h"
+
+class RequestTemplate;
+class TemplateArguments;
+
+/**
+ * HTTP/1.1 wire form of an HttpRequest, as a scatter-gather list.
+ *
+ * The iovecs point straight at the request's own strings (URL, query params,
+ * header values, body) and at static separators; the only bytes owned here are
+ * the Content-Length digits. Nothing is concatenated, so the result can go
+ * to writev() -- or any gather-capable transport -- as is.
+ *
+ * Adds what a bare HttpRequest lacks on the wire: the request target split
+ * from the URL, a Host header (unless one was set) and Content-Length (for a
+ * body, or an empty one on POST / PUT / PATCH). A Content-Length or
+ * Transfer-Encoding set on the request is ignored in favour of the computed
+ * framing.
+ *
+ * Contiguous bodies (owned, borrowed, memory-mapped) are one more iovec. A
+ * generated body is not: only the head is emitted -- with Content-Length, or
+ * Transfer-Encoding: chunked when the length is unknown -- and the caller
+ * streams the body after it (see streams_body( )).
+ *
+ * Borrows from the request: keep it alive, and unmodified, while the iovecs
+ * are in use. Not copyable or movable, as the iovecs point into this object.
+ */
+class WireRequest {
+public:
+    // enough for ~25 headers and ~20 query params
+    static constexpr size_t MAX_SEGMENTS = 192;
+
+    // throws std::invalid_argument for a URL without a scheme or for CR, LF
+    // or NUL in the host, target, a query param or a header (and for a space
+    // anywhere but a header value), and std::length_error if the request
+    // needs more than MAX_SEGMENTS iovecs
+    explicit WireRequest(const HttpRequest& request);
+
+    // a request instantiated from a template -- the precompiled head plus the
+    // bound slot values; throws std::invalid_argument for an unbound slot or
+    // a value holding CR, LF or NUL
+    WireRequest(const RequestTemplate& request_template,
+                const TemplateArguments& arguments);
+
+    WireRequest(const WireRequest&)            = delete;
+    WireRequest& operator=(const WireRequest&) = delete;
+
+    const iovec* data( ) const { return _segments.data( ); }
+    int          count( ) const { return static_cast<int>(_count); }
+    size_t       size_bytes( ) const { return _bytes; }
+
+    // the body is generated, and has to be sent after these iovecs
+    bool streams_body( ) const { return _streams_body; }
+    bool is_chunked( ) const { return _chunked; }
+
+    // the wire bytes in one string -- for logging and tests, not the hot path
+    std::string to_string( ) const;
+
+private:
+    std::array<iovec, MAX_SEGMENTS> _segments;
+    size_t                          _count = 0;
+    size_t                          _bytes = 0;
+    std::array<char, 24>            _content_length;
+    bool                            _streams_body = false;
+    bool                            _chunked      = false;
+
+    friend class RequestTemplate;
+
+    WireRequest( ) = default;
+
+    void append(std::string_view bytes);
+    void append_header(std::string_view name, std::string_view value);
+
+    // request line and headers, without Content-Length or the blank line
+    void append_head(const HttpRequest& request);
+    void append_content_length(size_t length);
+    // Content-Length (when due), the blank line and the body
+    void append_body(HttpMethod method, std::string_view body);
+    void append_body(HttpMethod method, const RequestBody& body);
+};
+
+#endif  // WIRE_FORMAT_H
@@ -0,0 +1,817 @@
+#include "async_http_client.h"
+#include "connection_pool_impl.h"
+#include "host_key.h"
+#include "range_download.h"
+#include "request_builder.h"
+#include "request_setup.h"
+#include "response_stream.h"
+#include "transfer_metrics_impl.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <curl/curl.h>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// one request, from submission until its completion has run
+struct Transfer {
+    uint64_t id = 0;
+    CURL* curl = nullptr;
+    std::optional<RequestSetup> setup;
+    std::string body;  // a copy, for post(); send() uses the request's
+    AsyncHTTPClient::Completion on_done;
+
+    // the caller's consumer, or the body collected for the completion
+    std::shared_ptr<ResponseConsumer> consumer;
+    StringConsumer collected;
+    ResponseStream stream;
+
+    // set from the thread requesting stop; the loop also hears of it by id
+    std::atomic<bool> cancelled{false};
+    std::optional<std::stop_callback<std::function<void()>>> on_stop;
+
+    ~Transfer() {
+        on_stop.reset();  // waits for a stop callback running elsewhere
+        if (curl) curl_easy_cleanup(curl);
+    }
+};
+
+std::exception_ptr make_error(const char* message) {
+    return std::make_exception_ptr(std::runtime_error(message));
+}
+
+std::exception_ptr make_cancelled() {
+    return std::make_exception_ptr(std::system_error(
+        std::make_error_code(std::errc::operation_canceled),
+        "Request cancelled"));
+}
+
+std::exception_ptr make_destroyed() {
+    return make_error("Client destroyed before the request completed");
+}
+
+// completions of a batch, passed from the loop to the waiting caller
+struct BatchInbox {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::vector<BatchResult> results;
+};
+
+} // namespace
+
+struct AsyncHTTPClient::Impl {
+    std::shared_ptr<ConnectionPool> pool;
+    std::shared_ptr<TransferMetrics> metrics;  // read by the loop
+    CURLM* multi;
+    int epoll_fd = -1;
+    int wake_fd = -1;  // eventfd: new submissions, or stop
+
+    // handed from the submitting threads to the loop
+    std::mutex submit_mutex;
+    std::vector<std::unique_ptr<Transfer>> submitted;
+    std::vector<uint64_t> cancel_requests;
+    std::exception_ptr stop_error;  // what is left fails with; set by stop()
+
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> pending{0};
+    std::atomic<uint64_t> next_id{1};
+
+    // owned by the loop thread
+    std::optional<Clock::time_point> deadline;  // curl's timer
+    std::unordered_map<uint64_t, Transfer*> active;  // in the multi handle
+    std::thread loop;
+
+    explicit Impl(std::shared_ptr<ConnectionPool> shared)
+        : pool(std::move(shared)) {
+        multi = curl_multi_init();
+        if (!multi)
+            throw std::runtime_error("Failed to initialize cURL multi.");
+
+        epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (epoll_fd < 0 || wake_fd < 0) {
+            int error = errno;
+            close_all();
+            throw std::system_error(error, std::generic_category(),
+                                    "Failed to create the event loop");
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = wake_fd;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+
+        curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, &socket_cb);
+        curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, &timer_cb);
+        curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+
+        loop = std::thread([this] { run(); });
+    }
+
+    ~Impl() {
+        stop(make_destroyed());
+        wake();
+        loop.join();
+        close_all();
+    }
+
+    void close_all() {
+        if (wake_fd >= 0) ::close(wake_fd);
+        if (epoll_fd >= 0) ::close(epoll_fd);
+        curl_multi_cleanup(multi);
+    }
+
+    // set under the lock that submit() checks it with
+    void stop(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(submit_mutex);
+        if (!stop_error) stop_error = error;
+        stopping = true;
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = ::write(wake_fd, &one, sizeof(one));
+    }
+
+    // runs on the calling thread; only handing over waits for the loop
+    void submit(const std::string& url, const std::string* body,
+                const RequestOptions& options, Completion on_done,
+                std::shared_ptr<ResponseConsumer> consumer = nullptr) {
+        submit(
+            [&](Transfer& transfer) {
+                if (body) transfer.body = *body;
+                transfer.setup->apply(url, body ? &transfer.body : nullptr);
+            },
+            options, std::move(on_done), std::move(consumer));
+    }
+
+    void submit(const HttpRequest& request, const RequestOptions& options,
+                Completion on_done,
+                std::shared_ptr<ResponseConsumer> consumer = nullptr) {
+        submit([&](Transfer& transfer) { transfer.setup->apply(request); },
+               options, std::move(on_done), std::move(consumer));
+    }
+
+    // `apply` sets the method, URL, headers and body up
+    template <typename Apply>
+    void submit(Apply apply, const RequestOptions& options,
+                Completion on_done,
+                std::shared_ptr<ResponseConsumer> consumer) {
+        auto transfer = std::make_unique<Transfer>();
+        transfer->id = next_id++;
+        transfer->on_done = std::move(on_done);
+
+        transfer->curl = curl_easy_init();
+        if (!transfer->curl)
+            throw std::runtime_error("Failed to initialize cURL.");
+
+        CURL* curl = transfer->curl;
+        transfer->setup.emplace(curl);
+        apply(*transfer);
+        transfer->consumer = std::move(consumer);
+        transfer->stream.attach(curl, transfer->consumer
+                                          ? transfer->consumer.get()
+                                          : &transfer->collected);
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer.get());
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS,
+                         static_cast<long>(options.timeout.count()));
+        if (pool) pool->pimpl->attach(curl);
+
+        if (options.stop.stop_possible()) {
+            // runs right here if stop was already requested
+            transfer->on_stop.emplace(
+                options.stop, [this, target = transfer.get()] {
+                    target->cancelled = true;
+                    cancel(target->id);
+                });
+        }
+
+        pending++;
+        {
+            // checked under the lock: once fail_remaining has taken the
+            // queue, nothing would pick the transfer up
+            std::unique_lock<std::mutex> lock(submit_mutex);
+            if (stopping) {
+                std::exception_ptr error = stop_error;
+                lock.unlock();
+                finish(std::move(transfer), error);
+                return;
+            }
+            submitted.push_back(std::move(transfer));
+        }
+        wake();
+    }
+
+    // Keeps up to max_in_flight of `count` requests sent, at most
+    // max_per_host of them to one host, and hands results to `on_result`
+    // on this thread. `send_one(index, on_done)` submits request `index`.
+    template <typename UrlOf, typename SendOne>
+    void run_batch(size_t count, UrlOf url_of, SendOne send_one,
+                   const BatchOptions& options,
+                   const BatchHandler& on_result) {
+        if (options.max_in_flight == 0 || options.max_per_host == 0)
+            throw std::invalid_argument("Batch limits must be at least 1");
+
+        // requests held back by their host's limit wait in its queue
+        struct Host {
+            size_t active = 0;
+            std::deque<size_t> waiting;
+        };
+        std::vector<Host> hosts;
+        std::vector<size_t> host_of(count);
+        {
+            std::unordered_map<std::string, size_t> ids;
+            for (size_t i = 0; i < count; ++i) {
+                // URLs curl cannot parse share "", and fail when sent
+                auto [found, added] =
+                    ids.try_emplace(host_key(url_of(i).c_str()), hosts.size());
+                if (added) hosts.emplace_back();
+                host_of[i] = found->second;
+            }
+        }
+
+        // the inbox is shared: a failed batch may leave completions behind
+        auto inbox = std::make_shared<BatchInbox>();
+        std::vector<BatchResult> arrived;
+        std::vector<size_t> freed;  // hosts with a free slot and a queue
+        size_t next = 0;
+        size_t in_flight = 0;
+        size_t delivered = 0;
+
+        // SUBMISSION order holds results back until those before are in
+        bool ordered = options.order == BatchOrder::SUBMISSION;
+        std::vector<std::optional<BatchResult>> held(ordered ? count : 0);
+        size_t next_out = 0;
+        auto deliver = [&](BatchResult& result) {
+            if (!ordered) {
+                ++delivered;
+                on_result(result);
+                return;
+            }
+            held[result.index] = std::move(result);
+            while (next_out < count && held[next_out]) {
+                ++delivered;
+                on_result(*held[next_out]);
+                held[next_out++].reset();
+            }
+        };
+
+        try {
+            while (delivered < count) {
+                if (options.request.stop.stop_requested()) {
+                    // what is in flight is cancelled by the same token
+                    freed.clear();
+                    std::vector<size_t> unsent;
+                    for (auto& host : hosts) {
+                        unsent.insert(unsent.end(), host.waiting.begin(),
+                                      host.waiting.end());
+                        host.waiting.clear();
+                    }
+                    while (next < count) unsent.push_back(next++);
+                    for (size_t index : unsent) {
+                        BatchResult result{index, {}, make_cancelled()};
+                        deliver(result);
+                    }
+                }
+
+                // hosts freed up first, then requests not looked at yet
+                while (in_flight < options.max_in_flight) {
+                    size_t index;
+                    if (!freed.empty()) {
+                        Host& host = hosts[freed.back()];
+                        freed.pop_back();
+                        // freed twice in a round, with one request waiting
+                        if (host.waiting.empty()) continue;
+                        index = host.waiting.front();
+                        host.waiting.pop_front();
+                    } else if (next < count) {
+                        index = next++;
+                        Host& host = hosts[host_of[index]];
+                        if (host.active == options.max_per_host) {
+                            host.waiting.push_back(index);
+                            continue;
+                        }
+                    } else {
+                        break;
+                    }
+
+                    // counted once sent: a request send_one threw for never
+                    // completes
+                    send_one(index, [inbox, index](std::string response,
+                                                   std::exception_ptr error) {
+                        std::lock_guard<std::mutex> lock(inbox->mutex);
+                        inbox->results.push_back(
+                            {index, std::move(response), error});
+                        inbox->arrived.notify_one();
+                    });
+                    ++hosts[host_of[index]].active;
+                    ++in_flight;
+                }
+                if (in_flight == 0) continue;  // all delivered, or cancelled
+
+                {
+                    std::unique_lock<std::mutex> lock(inbox->mutex);
+                    inbox->arrived.wait(
+                        lock, [&] { return !inbox->results.empty(); });
+                    arrived.swap(inbox->results);
+                }
+                // all of them are out of flight before on_result runs: if it
+                // throws, the rest are not waited for again
+                for (auto& result : arrived) {
+                    size_t host = host_of[result.index];
+                    --hosts[host].active;
+                    --in_flight;
+                    if (!hosts[host].waiting.empty()) freed.push_back(host);
+                }
+                for (auto& result : arrived) deliver(result);
+                arrived.clear();
+            }
+        } catch (...) {
+            // requests in flight may refer to the caller's; wait them out
+            std::unique_lock<std::mutex> lock(inbox->mutex);
+            while (in_flight > 0) {
+                inbox->arrived.wait(
+                    lock, [&] { return !inbox->results.empty(); });
+                in_flight -= inbox->results.size();
+                inbox->results.clear();
+            }
+            throw;
+        }
+    }
+
+    void cancel(uint64_t id) {
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            cancel_requests.push_back(id);
+        }
+        wake();
+    }
+
+    // the event loop
+
+    void run() {
+        std::vector<epoll_event> events(256);
+        while (!stopping) {
+            int timeout = -1;
+            if (deadline) {
+                auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+                    *deadline - Clock::now());
+                timeout =
+                    wait.count() > 0 ? static_cast<int>(wait.count()) : 0;
+            }
+
+            int count = ::epoll_wait(epoll_fd, events.data(),
+                                     static_cast<int>(events.size()), timeout);
+            if (count < 0 && errno != EINTR) {
+                // nothing would drive the transfers: fail them, and any
+                // submitted from now on
+                stop(std::make_exception_ptr(std::system_error(
+                    errno, std::generic_category(), "Event loop failed")));
+                break;
+            }
+
+            int running = 0;
+            for (int i = 0; i < count; ++i) {
+                if (events[i].data.fd == wake_fd) {
+                    uint64_t value;
+                    [[maybe_unused]] ssize_t got =
+                        ::read(wake_fd, &value, sizeof(value));
+                    add_submitted();
+                    continue;
+                }
+                int flags = 0;
+                if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+                if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    flags |= CURL_CSELECT_ERR;
+                curl_multi_socket_action(multi, events[i].data.fd, flags,
+                                         &running);
+            }
+
+            if (deadline && Clock::now() >= *deadline) {
+                // curl may set the next timer from inside this call
+                deadline.reset();
+                curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0,
+                                         &running);
+            }
+            complete_finished();
+        }
+        fail_remaining();
+    }
+
+    void add_submitted() {
+        std::vector<std::unique_ptr<Transfer>> batch;
+        std::vector<uint64_t> cancels;
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            batch.swap(submitted);
+            cancels.swap(cancel_requests);
+        }
+        for (auto& transfer : batch) {
+            // a cancel may be heard of before the transfer itself
+            if (transfer->cancelled) {
+                finish(std::move(transfer), make_cancelled());
+                continue;
+            }
+            if (pool) pool->pimpl->begin_transfer();
+            CURLMcode result = curl_multi_add_handle(multi, transfer->curl);
+            if (result != CURLM_OK) {
+                if (pool) pool->pimpl->end_transfer(transfer->curl, false);
+                finish(std::move(transfer),
+                       make_error(curl_multi_strerror(result)));
+                continue;
+            }
+            // the multi handle refers to it now; CURLOPT_PRIVATE takes it back
+            uint64_t id = transfer->id;
+            active.emplace(id, transfer.release());
+        }
+
+        // ids of transfers already completed are stale, and skipped
+        for (uint64_t id : cancels) {
+            auto found = active.find(id);
+            if (found == active.end()) continue;
+
+            std::unique_ptr<Transfer> transfer(found->second);
+            active.erase(found);
+            curl_multi_remove_handle(multi, transfer->curl);
+            if (pool) pool->pimpl->end_transfer(transfer->curl, false);
+            finish(std::move(transfer), make_cancelled());
+        }
+    }
+
+    void complete_finished() {
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) continue;
+
+            CURL* curl = message->easy_handle;
+            CURLcode result = message->data.result;
+            char* transfer_ptr = nullptr;
+            curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer_ptr);
+            std::unique_ptr<Transfer> transfer(
+                reinterpret_cast<Transfer*>(transfer_ptr));
+
+            curl_multi_remove_handle(multi, curl);
+            active.erase(transfer->id);
+            if (pool) pool->pimpl->end_transfer(curl, result == CURLE_OK);
+            if (metrics) metrics->pimpl->record(curl, result);
+            std::exception_ptr error = transfer->stream.finish_nothrow(result);
+            finish(std::move(transfer), error);
+        }
+    }
+
+    void finish(std::unique_ptr<Transfer> transfer, std::exception_ptr error) {
+        auto on_done = std::move(transfer->on_done);
+        std::string response = std::move(transfer->collected.body());
+        transfer.reset();  // the easy handle goes before the callback runs
+        pending--;
+        on_done(std::move(response), error);
+    }
+
+    // once stopped: everything added or still queued
+    void fail_remaining() {
+        // completions run outside the lock: they may submit again, which
+        // fails right away now that stopping is set
+        std::vector<std::unique_ptr<Transfer>> queued;
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            queued.swap(submitted);
+            error = stop_error;
+        }
+
+        for (auto [id, transfer] : active) {
+            curl_multi_remove_handle(multi, transfer->curl);
+            if (pool) pool->pimpl->end_transfer(transfer->curl, false);
+            finish(std::unique_ptr<Transfer>(transfer), error);
+        }
+        active.clear();
+
+        for (auto& transfer : queued) finish(std::move(transfer), error);
+    }
+
+    // curl callbacks
+
+    static int socket_cb(CURL*, curl_socket_t fd, int what, void* userp,
+                         void* socketp) {
+        auto* self = static_cast<Impl*>(userp);
+        if (what == CURL_POLL_REMOVE) {
+            // the socket may already be closed; nothing to do then
+            ::epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            curl_multi_assign(self->multi, fd, nullptr);
+            return 0;
+        }
+
+        epoll_event event{};
+        event.data.fd = fd;
+        if (what & CURL_POLL_IN) event.events |= EPOLLIN;
+        if (what & CURL_POLL_OUT) event.events |= EPOLLOUT;
+
+        // socketp marks a socket already in the epoll set
+        if (socketp) {
+            ::epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        } else {
+            ::epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+            curl_multi_assign(self->multi, fd, self);
+        }
+        return 0;
+    }
+
+    static int timer_cb(CURLM*, long timeout_ms, void* userp) {
+        auto* self = static_cast<Impl*>(userp);
+        if (timeout_ms < 0)
+            self->deadline.reset();
+        else
+            self->deadline =
+                Clock::now() + std::chrono::milliseconds(timeout_ms);
+        return 0;
+    }
+};
+
+namespace {
+
+AsyncHTTPClient::Completion fulfil(
+    std::shared_ptr<std::promise<std::string>> promise) {
+    return [promise](std::string response, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(std::move(response));
+    };
+}
+
+} // namespace
+
+AsyncHTTPClient::ResponseAwaiter::ResponseAwaiter(
+    AsyncHTTPClient& client, std::string url, std::optional<std::string> body,
+    RequestOptions options)
+    : client(client),
+      url(std::move(url)),
+      body(std::move(body)),
+      options(std::move(options)) {}
+
+AsyncHTTPClient::ResponseAwaiter::ResponseAwaiter(AsyncHTTPClient& client,
+                                                  const HttpRequest& request,
+                                                  RequestOptions options)
+    : client(client), request(&request), options(std::move(options)) {}
+
+bool AsyncHTTPClient::ResponseAwaiter::await_suspend(
+    std::coroutine_handle<> awaiting) {
+    handle = awaiting;
+    auto on_done = [this](std::string result, std::exception_ptr failure) {
+        response = std::move(result);
+        error = failure;
+        // still inside await_suspend: it will carry on by itself
+        if (suspended_or_done.exchange(true)) handle.resume();
+    };
+    if (request)
+        client.pimpl->submit(*request, options, std::move(on_done));
+    else
+        client.pimpl->submit(url, body ? &*body : nullptr, options,
+                             std::move(on_done));
+    // false if the transfer is already done: resume without suspending
+    return !suspended_or_done.exchange(true);
+}
+
+std::string AsyncHTTPClient::ResponseAwaiter::await_resume() {
+    if (error) std::rethrow_exception(error);
+    return std::move(response);
+}
+
+AsyncHTTPClient::AsyncHTTPClient() : AsyncHTTPClient(nullptr) {}
+
+AsyncHTTPClient::AsyncHTTPClient(std::shared_ptr<ConnectionPool> pool)
+    : pimpl(std::make_unique<Impl>(std::move(pool))) {}
+
+AsyncHTTPClient::~AsyncHTTPClient() = default;
+
+std::future<std::string> AsyncHTTPClient::get(const std::string& url,
+                                              RequestOptions options) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+    pimpl->submit(url, nullptr, options, fulfil(std::move(promise)));
+    return future;
+}
+
+std::future<std::string> AsyncHTTPClient::post(const std::string& url,
+                                               const std::string& body,
+                                               RequestOptions options) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+    pimpl->submit(url, &body, options, fulfil(std::move(promise)));
+    return future;
+}
+
+void AsyncHTTPClient::get(const std::string& url, Completion on_done,
+                          RequestOptions options) {
+    pimpl->submit(url, nullptr, options, std::move(on_done));
+}
+
+void AsyncHTTPClient::post(const std::string& url, const std::string& body,
+                           Completion on_done, RequestOptions options) {
+    pimpl->submit(url, &body, options, std::move(on_done));
+}
+
+void AsyncHTTPClient::get(const std::string& url,
+                          std::shared_ptr<ResponseConsumer> consumer,
+                          Completion on_done, RequestOptions options) {
+    pimpl->submit(url, nullptr, options, std::move(on_done),
+                  std::move(consumer));
+}
+
+void AsyncHTTPClient::post(const std::string& url, const std::string& body,
+                           std::shared_ptr<ResponseConsumer> consumer,
+                           Completion on_done, RequestOptions options) {
+    pimpl->submit(url, &body, options, std::move(on_done),
+                  std::move(consumer));
+}
+
+std::future<std::string> AsyncHTTPClient::send(const HttpRequest& request,
+                                               RequestOptions options) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+    pimpl->submit(request, options, fulfil(std::move(promise)));
+    return future;
+}
+
+void AsyncHTTPClient::send(const HttpRequest& request, Completion on_done,
+                           RequestOptions options) {
+    pimpl->submit(request, options, std::move(on_done));
+}
+
+void AsyncHTTPClient::send(const HttpRequest& request,
+                           std::shared_ptr<ResponseConsumer> consumer,
+                           Completion on_done, RequestOptions options) {
+    pimpl->submit(request, options, std::move(on_done), std::move(consumer));
+}
+
+AsyncHTTPClient::ResponseAwaiter AsyncHTTPClient::co_get(
+    std::string url, RequestOptions options) {
+    return ResponseAwaiter(*this, std::move(url), std::nullopt,
+                           std::move(options));
+}
+
+AsyncHTTPClient::ResponseAwaiter AsyncHTTPClient::co_post(
+    std::string url, std::string body, RequestOptions options) {
+    return ResponseAwaiter(*this, std::move(url), std::move(body),
+                           std::move(options));
+}
+
+AsyncHTTPClient::ResponseAwaiter AsyncHTTPClient::co_send(
+    const HttpRequest& request, RequestOptions options) {
+    return ResponseAwaiter(*this, request, std::move(options));
+}
+
+void AsyncHTTPClient::get_all(const std::vector<std::string>& urls,
+                              const BatchHandler& on_result,
+                              BatchOptions options) {
+    pimpl->run_batch(
+        urls.size(), [&](size_t index) { return urls[index]; },
+        [&](size_t index, Completion on_done) {
+            pimpl->submit(urls[index], nullptr, options.request,
+                          std::move(on_done));
+        },
+        options, on_result);
+}
+
+void AsyncHTTPClient::send_all(const std::vector<HttpRequestPtr>& requests,
+                               const BatchHandler& on_result,
+                               BatchOptions options) {
+    pimpl->run_batch(
+        requests.size(),
+        [&](size_t index) { return std::string(requests[index]->get_url()); },
+        [&](size_t index, Completion on_done) {
+            pimpl->submit(*requests[index], options.request,
+                          std::move(on_done));
+        },
+        options, on_result);
+}
+
+std::vector<BatchResult> AsyncHTTPClient::get_all(
+    const std::vector<std::string>& urls, BatchOptions options) {
+    std::vector<BatchResult> results;
+    results.reserve(urls.size());
+    get_all(
+        urls,
+        [&](BatchResult& result) { results.push_back(std::move(result)); },
+        std::move(options));
+    return results;
+}
+
+std::vector<BatchResult> AsyncHTTPClient::send_all(
+    const std::vector<HttpRequestPtr>& requests, BatchOptions options) {
+    std::vector<BatchResult> results;
+    results.reserve(requests.size());
+    send_all(
+        requests,
+        [&](BatchResult& result) { results.push_back(std::move(result)); },
+        std::move(options));
+    return results;
+}
+
+DownloadResult AsyncHTTPClient::download(const std::string& url,
+                                         const std::string& path,
+                                         DownloadOptions options) {
+    if (options.connections == 0 || options.range_bytes == 0)
+        throw std::invalid_argument("Download limits must be at least 1");
+
+    RangeFile file(path);
+
+    // the first byte: a 206 says how large, a 200 is the whole file
+    auto probe = std::make_shared<ProbeConsumer>(file);
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto probed = promise->get_future();
+    pimpl->submit(
+        [&](Transfer& transfer) {
+            transfer.setup->apply(url, nullptr);
+            transfer.setup->set_range(0, 0, {});
+            probe->attach(transfer.curl);
+        },
+        options.request, fulfil(std::move(promise)), probe);
+    probed.get();
+
+    DownloadResult result;
+    if (!probe->ranged()) {
+        file.finish();
+        result.bytes = file.range_done(0);
+        result.ranges = 1;
+        return result;
+    }
+
+    result.bytes = probe->total();
+    result.resumed_bytes = file.prepare(probe->total(), options.range_bytes,
+                                        probe->validator(), options.resume);
+    std::vector<size_t> pending;
+    for (size_t range = 0; range < file.ranges(); ++range)
+        if (file.range_done(range) < file.range_length(range))
+            pending.push_back(range);
+    result.ranges = file.ranges();
+
+    // one failed range stops the others, rather than waiting them out
+    std::stop_source stop;
+    std::stop_callback forward(options.request.stop,
+                               [&stop] { stop.request_stop(); });
+    BatchOptions batch;
+    batch.max_in_flight = options.connections;
+    batch.max_per_host = options.connections;
+    batch.order = BatchOrder::COMPLETION;
+    batch.request.timeout = options.request.timeout;
+    batch.request.stop = stop.get_token();
+
+    try {
+        pimpl->run_batch(
+            pending.size(), [&](size_t) { return url; },
+            [&](size_t index, Completion on_done) {
+                size_t range = pending[index];
+                uint64_t first =
+                    file.range_start(range) + file.range_done(range);
+                uint64_t last =
+                    file.range_start(range) + file.range_length(range) - 1;
+                pimpl->submit(
+                    [&](Transfer& transfer) {
+                        transfer.setup->apply(url, nullptr);
+                        transfer.setup->set_range(first, last,
+                                                  probe->validator());
+                    },
+                    batch.request, std::move(on_done),
+                    std::make_shared<RangeConsumer>(file, range));
+            },
+            batch, [&](BatchResult& done) {
+                if (!done.error) return;
+                stop.request_stop();
+                std::rethrow_exception(done.error);
+            });
+    } catch (...) {
+        // the batch has waited out the transfers still writing
+        file.save_progress();
+        throw;
+    }
+    file.finish();
+    return result;
+}
+
+void AsyncHTTPClient::set_metrics(std::shared_ptr<TransferMetrics> metrics) {
+    pimpl->metrics = std::move(metrics);
+}
+
+size_t AsyncHTTPClient::in_flight() const {
+    return pimpl->pending.load();
+}
@@ -0,0 +1,199 @@
+#ifndef ASYNC_HTTP_CLIENT
+#define ASYNC_HTTP_CLIENT
+
+#include "connection_pool.h"
+#include "response_consumer.h"
+#include "transfer_metrics.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+class HttpRequest;  // builder/request_builder.h
+struct HttpRequestDeleter;
+using HttpRequestPtr = std::unique_ptr<HttpRequest, HttpRequestDeleter>;
+
+// per-request settings of AsyncHTTPClient
+struct RequestOptions {
+    std::chrono::milliseconds timeout{0};  // whole transfer; 0: none
+    std::stop_token stop;                  // requesting stop cancels it
+};
+
+// the order in which get_all / send_all hand results over
+enum class BatchOrder { SUBMISSION, COMPLETION };
+
+// limits of get_all / send_all. Requests over a limit wait in the batch, not
+// in curl, so their timeouts only start once they are sent.
+struct BatchOptions {
+    size_t max_in_flight = 64;  // sent and not completed, all hosts together
+    size_t max_per_host = 6;    // of those, to one host and port
+    BatchOrder order = BatchOrder::SUBMISSION;
+    RequestOptions request;     // for each request; stop cancels the rest
+};
+
+// one request's outcome: the response, or the error
+struct BatchResult {
+    size_t index = 0;  // of the request in the batch
+    std::string response;
+    std::exception_ptr error;
+};
+
+// how download() splits the file
+struct DownloadOptions {
+    size_t connections = 4;                // ranges fetched at once
+    uint64_t range_bytes = 8 * 1024 * 1024;
+    bool resume = true;  // pick up what an earlier, failed call wrote
+    RequestOptions request;  // for each request; stop cancels the download
+};
+
+struct DownloadResult {
+    uint64_t bytes = 0;          // the size of the file
+    uint64_t resumed_bytes = 0;  // of those, already there from before
+    size_t ranges = 0;           // 1 if the server does not do ranges
+};
+
+// The non-blocking counterpart of HTTPClient. Requests are multiplexed by one
+// event loop thread (curl_multi_socket_action over epoll), so thousands can be
+// in flight without a thread each.
+//
+//   AsyncHTTPClient client;
+//   std::future<std::string> page = client.get("https://example.com/");
+//   client.get("https://example.com/a",
+//              [](std::string body, std::exception_ptr error) { ... });
+//
+//   HttpTask<size_t> fetch(AsyncHTTPClient& client) {  // http_task.h
+//       std::string page = co_await client.co_get("https://example.com/");
+//       co_return page.size();
+//   }
+//
+// Callbacks, and coroutines after a co_await, run on the loop thread: they
+// must be quick, must not throw and must not wait for another request of the
+// same client. Errors are std::runtime_errors, like HTTPClient's; a cancelled
+// request fails with std::errc::operation_canceled. Destroying the client
+// fails what is still in flight, and any request a completion submits then.
+class AsyncHTTPClient {
+public:
+    using Completion =
+        std::function<void(std::string response, std::exception_ptr error)>;
+    using BatchHandler = std::function<void(BatchResult& result)>;
+
+    // what co_get / co_post / co_send return: co_await it for the response
+    class ResponseAwaiter {
+    public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        std::string await_resume();
+
+    private:
+        friend class AsyncHTTPClient;
+
+        ResponseAwaiter(AsyncHTTPClient& client, std::string url,
+                        std::optional<std::string> body,
+                        RequestOptions options);
+        ResponseAwaiter(AsyncHTTPClient& client, const HttpRequest& request,
+                        RequestOptions options);
+
+        AsyncHTTPClient& client;
+        std::string url;
+        std::optional<std::string> body;
+        const HttpRequest* request = nullptr;  // or a url and body
+        RequestOptions options;
+
+        std::coroutine_handle<> handle;
+        std::string response;
+        std::exception_ptr error;
+        // set by whichever of suspension and completion comes first
+        std::atomic<bool> suspended_or_done{false};
+    };
+
+    AsyncHTTPClient();
+    explicit AsyncHTTPClient(std::shared_ptr<ConnectionPool> pool);
+    ~AsyncHTTPClient();
+
+    // the loop thread refers to the client, so it cannot move
+    AsyncHTTPClient(const AsyncHTTPClient&) = delete;
+    AsyncHTTPClient& operator=(const AsyncHTTPClient&) = delete;
+
+    std::future<std::string> get(const std::string& url,
+                                 RequestOptions options = {});
+    std::future<std::string> post(const std::string& url,
+                                  const std::string& body,
+                                  RequestOptions options = {});
+
+    void get(const std::string& url, Completion on_done,
+             RequestOptions options = {});
+    void post(const std::string& url, const std::string& body,
+              Completion on_done, RequestOptions options = {});
+
+    // the body streamed into `consumer` on the loop thread; the completion
+    // gets an empty response
+    void get(const std::string& url,
+             std::shared_ptr<ResponseConsumer> consumer, Completion on_done,
+             RequestOptions options = {});
+    void post(const std::string& url, const std::string& body,
+              std::shared_ptr<ResponseConsumer> consumer, Completion on_done,
+              RequestOptions options = {});
+
+    // a request from HttpRequestBuilder, as HTTPClient::send does it; the
+    // request must stay alive until the transfer completes
+    std::future<std::string> send(const HttpRequest& request,
+                                  RequestOptions options = {});
+    void send(const HttpRequest& request, Completion on_done,
+              RequestOptions options = {});
+    void send(const HttpRequest& request,
+              std::shared_ptr<ResponseConsumer> consumer, Completion on_done,
+              RequestOptions options = {});
+
+    ResponseAwaiter co_get(std::string url, RequestOptions options = {});
+    ResponseAwaiter co_post(std::string url, std::string body,
+                            RequestOptions options = {});
+    ResponseAwaiter co_send(const HttpRequest& request,
+                            RequestOptions options = {});
+
+    // Many requests, concurrently within the limits of `options`. Results
+    // are handed to `on_result` on the calling thread, in `options.order`, as
+    // they come in; the call returns when all are in. Not to be called from
+    // the loop thread (a callback or resumed coroutine of this client).
+    void get_all(const std::vector<std::string>& urls,
+                 const BatchHandler& on_result, BatchOptions options = {});
+    void send_all(const std::vector<HttpRequestPtr>& requests,
+                  const BatchHandler& on_result, BatchOptions options = {});
+
+    // the same, with the results returned in `options.order`
+    std::vector<BatchResult> get_all(const std::vector<std::string>& urls,
+                                     BatchOptions options = {});
+    std::vector<BatchResult> send_all(
+        const std::vector<HttpRequestPtr>& requests,
+        BatchOptions options = {});
+
+    // The resource at `url`, fetched into `path` in byte ranges over up to
+    // `options.connections` connections, each range written at its offset
+    // as it arrives. A server without range support sends it whole, on one.
+    // Blocks like get_all. If it fails, `path` keeps the ranges written so
+    // far, which a later call with `resume` fetches no more -- as long as
+    // the server has the same size and ETag (or Last-Modified) for it.
+    DownloadResult download(const std::string& url, const std::string& path,
+                            DownloadOptions options = {});
+
+    // per-phase timings and byte counts of every transfer, added to
+    // `metrics`; null stops recording. Not to be called with requests in
+    // flight.
+    void set_metrics(std::shared_ptr<TransferMetrics> metrics);
+
+    // requests submitted and not yet completed
+    size_t in_flight() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+#endif // ASYNC_HTTP_CLIENT
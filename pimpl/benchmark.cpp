@@ -0,0 +1,491 @@
+// HTTP client benchmark -- requests per second and latency percentiles of
+// the clients against an HTTP/1.1 server embedded in the benchmark, on
+// 127.0.0.1. Nothing leaves the machine, so runs can be compared with each
+// other, on machines without network access.
+//
+// Modes:
+//   sync        one HTTPClient on one thread
+//   pooled      a new HTTPClient per request, all sharing one ConnectionPool
+//               (DNS is shared, connections are not)
+//   concurrent  --threads threads sharing one HTTPClient and pool
+//   async       one AsyncHTTPClient, --threads requests in flight
+//
+// The server answers GET /?size=N&delay_us=D&close=1 with N bytes after D
+// microseconds, and closes the connection afterwards when asked to. Every
+// mode runs once per --sizes entry. One JSON object per run is written to
+// --output (default httpclient_benchmark.jsonl); a readable summary goes to
+// stderr.
+//
+//   httpclient_benchmark [--requests N] [--threads N] [--sizes 128,16384]
+//                        [--delay-us N] [--close] [--modes sync,async]
+//                        [--output path]
+
+#include "async_http_client.h"
+#include "connection_pool.h"
+#include "http_client.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// the digits `text` starts with, after any spaces
+size_t leading_number(std::string_view text) {
+    size_t value = 0;
+    size_t i = text.find_first_not_of(' ');
+    for (; i < text.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) break;
+        value = value * 10 + static_cast<size_t>(text[i] - '0');
+    }
+    return value;
+}
+
+// a numeric query parameter of the request target; 0 when missing
+size_t query_value(std::string_view target, std::string_view name) {
+    size_t query = target.find('?');
+    while (query != std::string_view::npos) {
+        std::string_view rest = target.substr(query + 1);
+        if (rest.substr(0, name.size()) == name &&
+            rest.substr(name.size(), 1) == "=")
+            return leading_number(rest.substr(name.size() + 1));
+        query = target.find('&', query + 1);
+    }
+    return 0;
+}
+
+bool send_all(int fd, const char* data, size_t size, int flags) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, flags | MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// A minimal HTTP/1.1 server: a thread per connection, keep-alive unless
+// the request says otherwise, and bodies cut from one preallocated buffer.
+class LoopbackServer {
+public:
+    explicit LoopbackServer(size_t max_body) : payload(max_body, 'x') {
+        listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+            throw std::system_error(errno, std::generic_category(), "socket");
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;  // any free port
+        socklen_t length = sizeof(address);
+        if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&address),
+                   sizeof(address)) != 0 ||
+            ::listen(listen_fd, SOMAXCONN) != 0 ||
+            ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address),
+                          &length) != 0) {
+            int error = errno;
+            ::close(listen_fd);
+            throw std::system_error(error, std::generic_category(), "listen");
+        }
+        bound_port = ntohs(address.sin_port);
+        acceptor = std::thread([this] { accept_loop(); });
+    }
+
+    ~LoopbackServer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            for (int fd : connections) ::shutdown(fd, SHUT_RDWR);
+        }
+        ::shutdown(listen_fd, SHUT_RDWR);
+        acceptor.join();
+        ::close(listen_fd);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this] { return connections.empty(); });
+    }
+
+    LoopbackServer(const LoopbackServer&) = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    uint16_t port() const { return bound_port; }
+
+private:
+    std::string payload;
+    int listen_fd = -1;
+    uint16_t bound_port = 0;
+    std::thread acceptor;
+
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::unordered_set<int> connections;  // open, each served by a thread
+    bool stopping = false;
+
+    void accept_loop() {
+        while (true) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;  // shut down
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) {
+                    ::close(fd);
+                    return;
+                }
+                connections.insert(fd);
+            }
+            std::thread([this, fd] { serve(fd); }).detach();
+        }
+    }
+
+    // requests on one connection until it is closed, by either side
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[16384];
+        bool open = true;
+        while (open) {
+            size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (received <= 0) {
+                    open = false;
+                    break;
+                }
+                buffer.append(chunk, static_cast<size_t>(received));
+            }
+            if (!open) break;
+
+            // header names in lower case, to find them
+            std::string head = buffer.substr(0, end);
+            for (char& c : head)
+                c = static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(c)));
+            size_t target_start = head.find(' ') + 1;
+            std::string_view target(
+                buffer.data() + target_start,
+                head.find(' ', target_start) - target_start);
+
+            size_t size = std::min(query_value(target, "size"),
+                                   payload.size());
+            size_t delay_us = query_value(target, "delay_us");
+            bool close =
+                query_value(target, "close") != 0 ||
+                head.find("\r\nconnection: close") != std::string::npos;
+            size_t request_body = 0;
+            constexpr std::string_view CONTENT_LENGTH = "\r\ncontent-length:";
+            size_t length = head.find(CONTENT_LENGTH);
+            if (length != std::string::npos)
+                request_body = leading_number(std::string_view(head).substr(
+                    length + CONTENT_LENGTH.size()));
+
+            // the request body is read and dropped
+            size_t consumed = end + 4 + request_body;
+            while (buffer.size() < consumed) {
+                ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (received <= 0) {
+                    open = false;
+                    break;
+                }
+                buffer.append(chunk, static_cast<size_t>(received));
+            }
+            if (!open) break;
+            buffer.erase(0, consumed);
+
+            if (delay_us > 0)
+                std::this_thread::sleep_for(
+                    std::chrono::microseconds(delay_us));
+
+            std::string header = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                                 std::to_string(size) +
+                                 "\r\nContent-Type: text/plain\r\n";
+            if (close) header += "Connection: close\r\n";
+            header += "\r\n";
+            open = send_all(fd, header.data(), header.size(),
+                            size > 0 ? MSG_MORE : 0) &&
+                   send_all(fd, payload.data(), size, 0) && !close;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        connections.erase(fd);
+        ::close(fd);
+        drained.notify_all();
+    }
+};
+
+struct Settings {
+    size_t requests = 2000;  // per run, for responses up to 16 KiB
+    size_t threads = 8;      // for the concurrent and async modes
+    std::vector<size_t> sizes = {128, 16384, 1024 * 1024};
+    size_t delay_us = 0;
+    bool close = false;  // a connection per request, instead of keep-alive
+    std::vector<std::string> modes = {"sync", "pooled", "concurrent",
+                                      "async"};
+    std::string output = "httpclient_benchmark.jsonl";
+};
+
+struct Result {
+    size_t requests = 0;
+    size_t failures = 0;
+    double seconds = 0;
+    std::vector<double> latencies_us;  // of the successful requests, sorted
+
+    double percentile(double fraction) const {
+        if (latencies_us.empty()) return 0;
+        size_t rank = std::min(
+            static_cast<size_t>(fraction *
+                                static_cast<double>(latencies_us.size())),
+            latencies_us.size() - 1);
+        return latencies_us[rank];
+    }
+};
+
+double micros_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start)
+        .count();
+}
+
+// `requests` calls of `get(thread)` on `threads` threads, timed one by one
+template <typename Get>
+Result run_threads(size_t requests, size_t threads, Get get) {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failures{0};
+    std::vector<std::vector<double>> latencies(threads);
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&, thread] {
+            while (next.fetch_add(1) < requests) {
+                auto sent = Clock::now();
+                try {
+                    get(thread);
+                    latencies[thread].push_back(micros_since(sent));
+                } catch (const std::exception&) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    Result result;
+    result.seconds = micros_since(start) / 1e6;
+    result.requests = requests;
+    result.failures = failures;
+    for (auto& samples : latencies)
+        result.latencies_us.insert(result.latencies_us.end(), samples.begin(),
+                                   samples.end());
+    return result;
+}
+
+// at most `in_flight` requests outstanding on the async client
+Result run_async(AsyncHTTPClient& client, const std::string& url,
+                 size_t requests, size_t in_flight) {
+    std::mutex mutex;
+    std::condition_variable completed;
+    size_t outstanding = 0;
+    Result result;
+    result.requests = requests;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            completed.wait(lock, [&] { return outstanding < in_flight; });
+            ++outstanding;
+        }
+        client.get(url, [&, sent = Clock::now()](std::string,
+                                                 std::exception_ptr error) {
+            double latency = micros_since(sent);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error)
+                ++result.failures;
+            else
+                result.latencies_us.push_back(latency);
+            --outstanding;
+            completed.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    completed.wait(lock, [&] { return outstanding == 0; });
+    result.seconds = micros_since(start) / 1e6;
+    return result;
+}
+
+// one run of `mode`; connections are opened by a first, untimed round
+Result run_mode(const std::string& mode, const std::string& url,
+                size_t requests, const Settings& settings) {
+    size_t threads = settings.threads;
+    Result result;
+    if (mode == "sync") {
+        HTTPClient client;
+        client.get(url);
+        result = run_threads(requests, 1, [&](size_t) { client.get(url); });
+    } else if (mode == "pooled") {
+        auto pool = std::make_shared<ConnectionPool>();
+        HTTPClient(pool).get(url);
+        result = run_threads(requests, 1, [&](size_t) {
+            HTTPClient client(pool);
+            client.get(url);
+        });
+    } else if (mode == "concurrent") {
+        HTTPClient client(std::make_shared<ConnectionPool>());
+        run_threads(threads, threads, [&](size_t) { client.get(url); });
+        result = run_threads(requests, threads,
+                             [&](size_t) { client.get(url); });
+    } else if (mode == "async") {
+        AsyncHTTPClient client;
+        run_async(client, url, threads, threads);
+        result = run_async(client, url, requests, threads);
+    } else {
+        throw std::invalid_argument("unknown mode " + mode);
+    }
+    std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    return result;
+}
+
+size_t threads_of(const std::string& mode, const Settings& settings) {
+    return mode == "concurrent" || mode == "async" ? settings.threads : 1;
+}
+
+std::string to_json(const std::string& mode, size_t size,
+                    const Settings& settings, const Result& result) {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(1) << "{\"mode\":\"" << mode
+         << "\",\"response_bytes\":" << size
+         << ",\"delay_us\":" << settings.delay_us
+         << ",\"keep_alive\":" << (settings.close ? "false" : "true")
+         << ",\"threads\":" << threads_of(mode, settings)
+         << ",\"requests\":" << result.requests
+         << ",\"failures\":" << result.failures
+         << ",\"requests_per_sec\":" << result.requests / result.seconds
+         << ",\"p50_us\":" << result.percentile(0.5)
+         << ",\"p90_us\":" << result.percentile(0.9)
+         << ",\"p99_us\":" << result.percentile(0.99)
+         << ",\"max_us\":" << result.percentile(1.0) << "}";
+    return json.str();
+}
+
+template <typename Parse>
+auto split(const std::string& list, Parse parse) {
+    std::vector<decltype(parse(std::string()))> values;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty()) values.push_back(parse(item));
+    return values;
+}
+
+Settings parse_settings(int argc, char** argv) {
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--close") {
+            settings.close = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << "missing value for " << flag << "\n";
+            break;
+        }
+        std::string value = argv[++i];
+
+        if (flag == "--requests") {
+            settings.requests = std::stoul(value);
+        } else if (flag == "--threads") {
+            settings.threads = std::stoul(value);
+        } else if (flag == "--sizes") {
+            settings.sizes = split(value, [](const std::string& item) {
+                return std::stoul(item);
+            });
+        } else if (flag == "--delay-us") {
+            settings.delay_us = std::stoul(value);
+        } else if (flag == "--modes") {
+            settings.modes =
+                split(value, [](const std::string& item) { return item; });
+        } else if (flag == "--output") {
+            settings.output = value;
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+        }
+    }
+    settings.requests = std::max<size_t>(1, settings.requests);
+    settings.threads = std::max<size_t>(1, settings.threads);
+    return settings;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings = parse_settings(argc, argv);
+
+    try {
+        LoopbackServer server(
+            *std::max_element(settings.sizes.begin(), settings.sizes.end()));
+        std::ofstream output(settings.output, std::ios::trunc);
+        std::cerr << "server on 127.0.0.1:" << server.port() << ", "
+                  << (settings.close ? "a connection per request"
+                                     : "keep-alive")
+                  << ", " << settings.delay_us << " us delay\n"
+                  << std::left << std::setw(12) << "mode" << std::setw(10)
+                  << "bytes" << std::setw(9) << "threads" << std::setw(12)
+                  << "req/s" << std::setw(10) << "p50 us" << std::setw(10)
+                  << "p90 us" << std::setw(10) << "p99 us" << "failures\n";
+
+        for (size_t size : settings.sizes) {
+            std::string url = "http://127.0.0.1:" +
+                              std::to_string(server.port()) +
+                              "/?size=" + std::to_string(size) +
+                              "&delay_us=" + std::to_string(settings.delay_us) +
+                              (settings.close ? "&close=1" : "");
+            // about the same bytes for every size past 16 KiB
+            size_t requests =
+                size > 16384
+                    ? std::max<size_t>(100, settings.requests * 16384 / size)
+                    : settings.requests;
+
+            for (const auto& mode : settings.modes) {
+                Result result = run_mode(mode, url, requests, settings);
+                output << to_json(mode, size, settings, result) << "\n";
+
+                std::cerr << std::left << std::fixed << std::setprecision(0)
+                          << std::setw(12) << mode << std::setw(10) << size
+                          << std::setw(9) << threads_of(mode, settings)
+                          << std::setw(12) << result.requests / result.seconds
+                          << std::setw(10) << result.percentile(0.5)
+                          << std::setw(10) << result.percentile(0.9)
+                          << std::setw(10) << result.percentile(0.99)
+                          << result.failures << "\n";
+            }
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,102 @@
+#include "connection_pool.h"
+#include "connection_pool_impl.h"
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+ConnectionPool::Impl::Impl(Options options) : options(options) {
+    share = curl_share_init();
+    if (!share) throw std::runtime_error("Failed to initialize cURL share.");
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &lock_cb);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &unlock_cb);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+
+    // Not CURL_LOCK_DATA_CONNECT: libcurl does not support a shared connection
+    // cache used by several threads at once. Connections stay with the handle
+    // (or multi handle) that opened them.
+    for (auto data : {CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION}) {
+        CURLSHcode result = curl_share_setopt(share, CURLSHOPT_SHARE, data);
+        if (result != CURLSHE_OK) {
+            curl_share_cleanup(share);
+            throw std::runtime_error(curl_share_strerror(result));
+        }
+    }
+}
+
+ConnectionPool::Impl::~Impl() {
+    curl_share_cleanup(share);
+}
+
+void ConnectionPool::Impl::attach(CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT,
+                     static_cast<long>(options.dns_cache_ttl.count()));
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN,
+                     static_cast<long>(options.max_idle_time.count()));
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, &open_socket_cb);
+    curl_easy_setopt(curl, CURLOPT_OPENSOCKETDATA, this);
+    curl_easy_setopt(curl, CURLOPT_CLOSESOCKETFUNCTION, &close_socket_cb);
+    curl_easy_setopt(curl, CURLOPT_CLOSESOCKETDATA, this);
+}
+
+void ConnectionPool::Impl::begin_transfer() {
+    active_transfers++;
+}
+
+void ConnectionPool::Impl::end_transfer(CURL* curl, bool succeeded) {
+    active_transfers--;
+    if (!succeeded) return;
+
+    // new connections made for the transfer: none means it reused one
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    (connects == 0 ? hits : misses)++;
+}
+
+void ConnectionPool::Impl::lock_cb(CURL*, curl_lock_data data,
+                                   curl_lock_access, void* userptr) {
+    static_cast<Impl*>(userptr)->locks[data].lock();
+}
+
+void ConnectionPool::Impl::unlock_cb(CURL*, curl_lock_data data,
+                                     void* userptr) {
+    static_cast<Impl*>(userptr)->locks[data].unlock();
+}
+
+// Sockets are counted as they are opened and closed, over every handle
+// attached to the pool.
+curl_socket_t ConnectionPool::Impl::open_socket_cb(void* clientp,
+                                                   curlsocktype,
+                                                   curl_sockaddr* address) {
+    curl_socket_t fd =
+        ::socket(address->family, address->socktype, address->protocol);
+    if (fd != CURL_SOCKET_BAD) static_cast<Impl*>(clientp)->open_sockets++;
+    return fd;
+}
+
+int ConnectionPool::Impl::close_socket_cb(void* clientp, curl_socket_t fd) {
+    static_cast<Impl*>(clientp)->open_sockets--;
+    return ::close(fd);
+}
+
+ConnectionPool::ConnectionPool() : ConnectionPool(Options{}) {}
+
+ConnectionPool::ConnectionPool(Options options)
+    : pimpl(std::make_unique<Impl>(options)) {}
+
+ConnectionPool::~ConnectionPool() = default;
+
+ConnectionPool::Stats ConnectionPool::stats() const {
+    Stats stats;
+    stats.hits = pimpl->hits.load();
+    stats.misses = pimpl->misses.load();
+    stats.open_connections = pimpl->open_sockets.load();
+
+    // a multiplexed connection can carry several transfers
+    uint64_t active = pimpl->active_transfers.load();
+    stats.idle_connections =
+        stats.open_connections > active ? stats.open_connections - active : 0;
+    return stats;
+}
@@ -0,0 +1,53 @@
+#ifndef CONNECTION_POOL
+#define CONNECTION_POOL
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Caches shared by any number of HTTPClients, on any number of threads: DNS
+// answers and TLS sessions. A client created per worker resolves nothing
+// another client already resolved, and resumes its TLS sessions instead of
+// handshaking from scratch.
+//
+//   auto pool = std::make_shared<ConnectionPool>();
+//   HTTPClient a(pool), b(pool);  // b resumes a's TLS session with the host
+//
+// Open connections are not shared: libcurl's connection cache cannot be used
+// by several threads at once. Each client keeps its own, per handle, and the
+// pool's stats count them across all its clients. Each cache has its own
+// lock, so a DNS lookup does not wait for a session being stored.
+class ConnectionPool {
+public:
+    struct Options {
+        std::chrono::seconds dns_cache_ttl{60};
+        std::chrono::seconds max_idle_time{118};  // then a connection is closed
+    };
+
+    struct Stats {
+        // over every client attached to the pool
+        uint64_t hits;              // transfers that reused an open connection
+        uint64_t misses;            // transfers that had to open one
+        uint64_t open_connections;
+        uint64_t idle_connections;  // open and not carrying a transfer
+    };
+
+    ConnectionPool();
+    explicit ConnectionPool(Options options);
+    ~ConnectionPool();
+
+    // shared by pointer, never copied or moved
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    Stats stats() const;
+
+private:
+    friend class HTTPClient;
+    friend class AsyncHTTPClient;
+
+    struct Impl;  // connection_pool_impl.h
+    std::unique_ptr<Impl> pimpl;
+};
+
+#endif // CONNECTION_POOL
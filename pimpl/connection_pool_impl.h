@@ -0,0 +1,46 @@
+#ifndef CONNECTION_POOL_IMPL
+#define CONNECTION_POOL_IMPL
+
+// Private to the httpclient library: what HTTPClient::Impl needs to see of
+// the pool. Not installed, and never included by clients.
+
+#include "connection_pool.h"
+#include <atomic>
+#include <curl/curl.h>
+#include <mutex>
+
+struct ConnectionPool::Impl {
+    CURLSH* share;
+    Options options;
+
+    // one lock per shared cache, indexed by curl_lock_data
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> open_sockets{0};
+    std::atomic<uint64_t> active_transfers{0};
+
+    explicit Impl(Options options);
+    ~Impl();
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    // points an easy handle at the shared caches
+    void attach(CURL* curl);
+
+    // around every transfer on an attached handle
+    void begin_transfer();
+    void end_transfer(CURL* curl, bool succeeded);
+
+    // curl callbacks, with the Impl as user data
+    static void lock_cb(CURL*, curl_lock_data data, curl_lock_access,
+                        void* userptr);
+    static void unlock_cb(CURL*, curl_lock_data data, void* userptr);
+    static curl_socket_t open_socket_cb(void* clientp, curlsocktype,
+                                        curl_sockaddr* address);
+    static int close_socket_cb(void* clientp, curl_socket_t fd);
+};
+
+#endif // CONNECTION_POOL_IMPL
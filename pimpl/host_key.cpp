@@ -0,0 +1,20 @@
+#include "host_key.h"
+#include <curl/curl.h>
+
+std::string host_key(const char* url) {
+    std::string key;
+    CURLU* parsed = curl_url();
+    if (parsed && curl_url_set(parsed, CURLUPART_URL, url, 0) == CURLUE_OK) {
+        char* host = nullptr;
+        char* port = nullptr;
+        curl_url_get(parsed, CURLUPART_HOST, &host, 0);
+        curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT);
+        if (host) key.append(host);
+        key.push_back(':');
+        if (port) key.append(port);
+        curl_free(host);
+        curl_free(port);
+    }
+    curl_url_cleanup(parsed);
+    return key;
+}
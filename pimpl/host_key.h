@@ -0,0 +1,12 @@
+#ifndef HOST_KEY
+#define HOST_KEY
+
+// Private to the httpclient library.
+
+#include <string>
+
+// "host:port" of a URL, with the scheme's default port filled in; URLs curl
+// cannot parse all give ""
+std::string host_key(const char* url);
+
+#endif // HOST_KEY
@@ -1,56 +1,620 @@
 #include "http_client.h"
+#include "connection_pool_impl.h"
+#include "request_setup.h"
+#include "response_cache_impl.h"
+#include "response_stream.h"
+#include "transfer_metrics_impl.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <curl/curl.h>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 
-struct HTTPClient::Impl {
-    CURL* curl;
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Passes a response on to the caller's consumer and keeps a copy of a 200
+// body for the cache, up to `limit` bytes. A 304 is not passed on: the
+// cached body is, once the transfer is over.
+class CachingConsumer : public ResponseConsumer {
+public:
+    CachingConsumer(ResponseConsumer& target, size_t limit)
+        : target(target), limit(limit) {}
+
+    void on_start(long status, size_t content_length) override {
+        received_status = status;
+        if (status == 304) return;
+        keeping = status == 200 && (content_length == UNKNOWN_LENGTH ||
+                                    content_length <= limit);
+        if (keeping && content_length != UNKNOWN_LENGTH)
+            copy.reserve(content_length);
+        target.on_start(status, content_length);
+    }
+
+    bool on_data(std::string_view chunk) override {
+        if (received_status == 304) return true;
+        if (keeping && chunk.size() > limit - copy.size()) {
+            keeping = false;
+            copy = std::string();
+        }
+        if (keeping) copy.append(chunk);
+        return target.on_data(chunk);
+    }
+
+    void on_complete() override {
+        if (received_status != 304) target.on_complete();
+    }
+
+    long status() const { return received_status; }
+    bool kept() const { return keeping; }
+    std::string& body() { return copy; }
+
+private:
+    ResponseConsumer& target;
+    size_t limit;
+    long received_status = 0;
+    bool keeping = false;
+    std::string copy;
+};
+
+
+// A request that does no harm when sent twice. A generated body is read as
+// it is sent, so it cannot be.
+bool repeatable(const HttpRequest& request) {
+    switch (request.get_method()) {
+        case HttpMethod::GET:
+        case HttpMethod::HEAD:
+        case HttpMethod::PUT:
+        case HttpMethod::DELETE:
+        case HttpMethod::OPTIONS:
+            return request.get_body().is_contiguous();
+        case HttpMethod::POST:
+        case HttpMethod::PATCH: break;
+    }
+    return false;
+}
+
+// failures another attempt may not have, if nothing was delivered yet
+bool transient(CURLcode result) {
+    switch (result) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool transient_status(long status) {
+    return status == 502 || status == 503 || status == 504;
+}
+
+// One copy of a request that may be retried or hedged. A response worth
+// retrying is held back from the caller's consumer, and of two copies only
+// the first to respond reaches it; the other is stopped.
+class Attempt : public ResponseConsumer {
+public:
+    Attempt(ResponseConsumer& target, const Attempt*& winner, bool may_retry)
+        : target(target), winner(winner), may_retry(may_retry) {}
+
+    void on_start(long status, size_t content_length) override {
+        received_status = status;
+        if (held_back() || winner) return;
+        winner = this;
+        target.on_start(status, content_length);
+    }
+
+    bool on_data(std::string_view chunk) override {
+        if (delivering()) return target.on_data(chunk);
+        return held_back();  // drained, to keep the connection
+    }
+
+    void on_complete() override {
+        if (delivering()) target.on_complete();
+    }
 
-    Impl() {
-        curl = curl_easy_init();
-        if (!curl) throw std::runtime_error("Failed to initialize cURL.");
+    bool delivering() const { return winner == this; }
+    bool held_back() const {
+        return may_retry && transient_status(received_status);
     }
+    long status() const { return received_status; }
+
+private:
+    ResponseConsumer& target;
+    const Attempt*& winner;
+    bool may_retry;
+    long received_status = 0;
+};
+
+// how an attempt ended
+struct Outcome {
+    CURL* curl;  // the handle it ran on
+    CURLcode result;
+    std::exception_ptr error;
+    long status;
+    bool delivered;  // reached the caller's consumer
+    bool held_back;
+};
+
+// times to first byte of recent successful requests, for the hedge delay
+class LatencyWindow {
+public:
+    static constexpr size_t SIZE = 128;
+
+    void add(Clock::duration latency) {
+        samples[next] = latency;
+        next = (next + 1) % SIZE;
+        count = std::min(count + 1, SIZE);
+    }
+
+    size_t size() const { return count; }
+
+    Clock::duration percentile(double fraction) const {
+        std::array<Clock::duration, SIZE> sorted = samples;
+        size_t rank = std::min(
+            static_cast<size_t>(fraction * static_cast<double>(count)),
+            count - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank,
+                         sorted.begin() + count);
+        return sorted[rank];
+    }
+
+private:
+    std::array<Clock::duration, SIZE> samples{};
+    size_t next = 0;
+    size_t count = 0;
+};
+
+} // namespace
+
+struct HTTPClient::Impl {
+    // an easy handle and what it is configured with
+    struct Handle {
+        CURL* curl;
+        RequestSetup setup;
+        ResponseStream stream;
+
+        explicit Handle(ConnectionPool* pool)
+            : curl(curl_easy_init()), setup(curl) {
+            if (!curl) throw std::runtime_error("Failed to initialize cURL.");
+            if (pool) pool->pimpl->attach(curl);
+        }
+
+        ~Handle() {
+            curl_easy_cleanup(curl);
+        }
+    };
+
+    // What one request at a time needs: a handle, and for hedging a second
+    // one, raced with the first on a multi handle. Calls lease a Lease for
+    // their duration, so that threads sharing the client never share one.
+    struct Lease {
+        Handle main;
+        std::unique_ptr<Handle> spare;
+        CURLM* multi = nullptr;
+
+        explicit Lease(ConnectionPool* pool) : main(pool) {}
+
+        ~Lease() {
+            if (multi) curl_multi_cleanup(multi);
+        }
+    };
+
+    // hands a lease back to the idle ones when the call is done
+    struct Release {
+        Impl* impl;
+        void operator()(Lease* lease) const { impl->release(lease); }
+    };
+    using LeasePtr = std::unique_ptr<Lease, Release>;
+
+    // idle leases kept, warm; beyond them, returned leases are freed
+    static constexpr size_t IDLE_LEASES = 64;
+
+    std::shared_ptr<ConnectionPool> pool;  // outlives curl, which may use it
+    std::shared_ptr<ResponseCache> cache;
+    std::shared_ptr<TransferMetrics> metrics;
+
+    // Taken by swapping in null, put back by swapping it out again. A slot
+    // only ever changes hands whole, so no lock is needed.
+    std::array<std::atomic<Lease*>, IDLE_LEASES> idle{};
+
+    // opt-in tail latency policies, shared by all calls
+    std::optional<HedgePolicy> hedging;
+    std::optional<RetryPolicy> retries;
+    RetryBudget budget;
+    std::atomic<double> tokens{budget.max_tokens};
+    std::mutex latency_mutex;
+    LatencyWindow first_byte;  // guarded by latency_mutex
+
+    explicit Impl(std::shared_ptr<ConnectionPool> shared = nullptr,
+                  std::shared_ptr<ResponseCache> responses = nullptr)
+        : pool(std::move(shared)), cache(std::move(responses)) {}
 
     ~Impl() {
-        curl_easy_cleanup(curl);
+        for (auto& slot : idle) delete slot.load();
+    }
+
+    // Probing starts at a slot picked by the thread, so a thread mostly gets
+    // back the handle it used last, with its connections still open.
+    static size_t home_slot() {
+        return std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+               IDLE_LEASES;
+    }
+
+    LeasePtr lease() {
+        size_t start = home_slot();
+        for (size_t probe = 0; probe < IDLE_LEASES; ++probe) {
+            auto& slot = idle[(start + probe) % IDLE_LEASES];
+            if (!slot.load(std::memory_order_relaxed)) continue;
+            Lease* found = slot.exchange(nullptr, std::memory_order_acquire);
+            if (found) return LeasePtr(found, Release{this});
+        }
+        return LeasePtr(new Lease(pool.get()), Release{this});
     }
 
-    std::string perform(const std::string& url, const std::string* body = nullptr) {
-        std::string response;
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_cb);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    void release(Lease* lease) {
+        size_t start = home_slot();
+        for (size_t probe = 0; probe < IDLE_LEASES; ++probe) {
+            auto& slot = idle[(start + probe) % IDLE_LEASES];
+            Lease* empty = nullptr;
+            if (slot.compare_exchange_strong(empty, lease,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+                return;
+        }
+        delete lease;
+    }
+
+    // Runs the request `apply` sets a handle up for, into `consumer`, and
+    // returns the handle the response came from; it is the lease's. Only
+    // repeatable requests are retried or hedged.
+    template <typename Apply>
+    CURL* perform(Lease& lease, Apply apply, bool repeatable,
+                  ResponseConsumer& consumer) {
+        Handle& main = lease.main;
+        if (!repeatable || (!hedging && !retries)) {
+            apply(main.setup);
+            main.stream.attach(main.curl, &consumer);
+            main.stream.finish(run(main));
+            return main.curl;
+        }
+
+        deposit();
+        int attempts = retries ? std::max(retries->max_attempts, 1) : 1;
+        for (int attempt = 1;; ++attempt) {
+            bool may_retry = attempt < attempts &&
+                             tokens.load(std::memory_order_relaxed) >= 1;
+            std::optional<Clock::duration> delay = hedge_delay();
+            Outcome outcome =
+                delay ? race(lease, apply, consumer, may_retry, *delay)
+                      : single(main, apply, consumer, may_retry);
+            if (!outcome.error && !outcome.held_back) {
+                curl_off_t microseconds = 0;
+                curl_easy_getinfo(outcome.curl, CURLINFO_STARTTRANSFER_TIME_T,
+                                  &microseconds);
+                std::lock_guard<std::mutex> lock(latency_mutex);
+                first_byte.add(std::chrono::microseconds(microseconds));
+                return outcome.curl;
+            }
+
+            bool worth_it = outcome.held_back || (!outcome.delivered &&
+                                                  transient(outcome.result));
+            if (may_retry && worth_it && take_token()) {
+                std::this_thread::sleep_for(backoff(attempt));
+                continue;
+            }
+            if (outcome.error) std::rethrow_exception(outcome.error);
+            // held back, and a hedge took the last token meanwhile
+            throw std::runtime_error("HTTP " + std::to_string(outcome.status) +
+                                     " with no retry left");
+        }
+    }
+
+    // one transfer on a set up handle
+    CURLcode run(Handle& handle) {
+        if (pool) pool->pimpl->begin_transfer();
+        CURLcode result = curl_easy_perform(handle.curl);
+        if (pool) pool->pimpl->end_transfer(handle.curl, result == CURLE_OK);
+        if (metrics) metrics->pimpl->record(handle.curl, result);
+        return result;
+    }
+
+    template <typename Apply>
+    Outcome single(Handle& main, Apply& apply, ResponseConsumer& consumer,
+                   bool may_retry) {
+        const Attempt* winner = nullptr;
+        Attempt attempt(consumer, winner, may_retry);
+        apply(main.setup);
+        main.stream.attach(main.curl, &attempt);
+        return outcome_of(main, attempt, run(main));
+    }
+
+    static Outcome outcome_of(Handle& handle, const Attempt& attempt,
+                              CURLcode result) {
+        std::exception_ptr error = handle.stream.finish_nothrow(result);
+        return {handle.curl,         result,
+                error,               attempt.status(),
+                attempt.delivering(), attempt.held_back()};
+    }
+
+    // The request on the main handle, and again on the spare one if nothing
+    // has arrived after `delay`. The first to respond is delivered and the
+    // other removed; when neither does, the last to end is the outcome.
+    template <typename Apply>
+    Outcome race(Lease& lease, Apply& apply, ResponseConsumer& consumer,
+                 bool may_retry, Clock::duration delay) {
+        if (!lease.multi) {
+            lease.spare = std::make_unique<Handle>(pool.get());
+            lease.multi = curl_multi_init();
+            if (!lease.multi)
+                throw std::runtime_error("Failed to initialize cURL multi.");
+        }
+        Handle& main = lease.main;
+        CURLM* multi = lease.multi;
 
-        if (body) { // POST
-            curl_easy_setopt(curl, CURLOPT_POST, 1L);
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->c_str());
-        } else { // GET
-            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        const Attempt* winner = nullptr;
+        Attempt first(consumer, winner, may_retry);
+        Attempt second(consumer, winner, may_retry);
+        std::array<Handle*, 2> handles = {&main, lease.spare.get()};
+        std::array<Attempt*, 2> attempts = {&first, &second};
+        std::array<bool, 2> running = {false, false};
+        std::array<std::optional<Outcome>, 2> outcomes;
+        int last = 0;
+
+        auto start = [&](int i) {
+            apply(handles[i]->setup);
+            handles[i]->stream.attach(handles[i]->curl, attempts[i]);
+            if (pool) pool->pimpl->begin_transfer();
+            CURLMcode added = curl_multi_add_handle(multi, handles[i]->curl);
+            if (added != CURLM_OK) {
+                if (pool) pool->pimpl->end_transfer(handles[i]->curl, false);
+                throw std::runtime_error(curl_multi_strerror(added));
+            }
+            running[i] = true;
+        };
+        auto stop = [&](int i, CURLcode result) {
+            curl_multi_remove_handle(multi, handles[i]->curl);
+            if (pool)
+                pool->pimpl->end_transfer(handles[i]->curl,
+                                          result == CURLE_OK);
+            running[i] = false;
+        };
+
+        try {
+            start(0);
+            Clock::time_point hedge_at = Clock::now() + delay;
+            bool hedged = false;
+            while (true) {
+                int active = 0;
+                curl_multi_perform(multi, &active);
+
+                int queued = 0;
+                while (CURLMsg* done = curl_multi_info_read(multi, &queued)) {
+                    if (done->msg != CURLMSG_DONE) continue;
+                    int i = done->easy_handle == main.curl ? 0 : 1;
+                    stop(i, done->data.result);
+                    if (metrics)
+                        metrics->pimpl->record(done->easy_handle,
+                                               done->data.result);
+                    outcomes[i] = outcome_of(*handles[i], *attempts[i],
+                                             done->data.result);
+                    last = i;
+                }
+
+                for (int i = 0; i < 2; ++i) {
+                    if (!attempts[i]->delivering()) continue;
+                    if (running[1 - i])
+                        stop(1 - i, CURLE_ABORTED_BY_CALLBACK);
+                    if (outcomes[i]) return *outcomes[i];
+                }
+                if (!running[0] && !running[1]) return *outcomes[last];
+
+                if (!hedged && !winner && Clock::now() >= hedge_at) {
+                    hedged = true;
+                    if (take_token()) start(1);
+                }
+
+                using std::chrono::milliseconds;
+                milliseconds wait(1000);
+                if (!hedged)
+                    wait = std::min(wait, std::chrono::ceil<milliseconds>(
+                                              hedge_at - Clock::now()));
+                curl_multi_poll(multi, nullptr, 0,
+                                std::max(0, static_cast<int>(wait.count())),
+                                nullptr);
+            }
+        } catch (...) {
+            for (int i = 0; i < 2; ++i)
+                if (running[i]) stop(i, CURLE_ABORTED_BY_CALLBACK);
+            throw;
         }
+    }
+
+    // none yet when the percentile has too few samples
+    std::optional<Clock::duration> hedge_delay() {
+        if (!hedging) return std::nullopt;
+        if (hedging->delay.count() > 0) return hedging->delay;
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        if (first_byte.size() < std::max<size_t>(hedging->min_samples, 1))
+            return std::nullopt;
+        return first_byte.percentile(hedging->percentile);
+    }
 
-        CURLcode result = curl_easy_perform(curl);
-        if (result != CURLE_OK) throw std::runtime_error(curl_easy_strerror(result));
+    // each request adds `ratio` of a token, up to the cap
+    void deposit() {
+        double current = tokens.load(std::memory_order_relaxed);
+        while (!tokens.compare_exchange_weak(
+            current, std::min(current + budget.ratio, budget.max_tokens),
+            std::memory_order_relaxed)) {
+        }
+    }
 
-        return response;
+    bool take_token() {
+        double current = tokens.load(std::memory_order_relaxed);
+        do {
+            if (current < 1) return false;
+        } while (!tokens.compare_exchange_weak(current, current - 1,
+                                               std::memory_order_relaxed));
+        return true;
     }
 
-    static size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
-        auto* out = static_cast<std::string*>(userdata);
-        out->append(ptr, size * nmemb);
-        return size * nmemb;
+    // "full jitter": anywhere up to the exponential backoff
+    Clock::duration backoff(int attempt) {
+        thread_local std::mt19937 jitter{std::random_device{}()};
+        std::chrono::milliseconds ceiling = std::min<std::chrono::milliseconds>(
+            retries->base_backoff * (1 << std::min(attempt - 1, 20)),
+            retries->max_backoff);
+        std::uniform_int_distribution<long long> pick(0, ceiling.count());
+        return std::chrono::milliseconds(pick(jitter));
+    }
+
+    // a GET through the cache, if there is one
+    void get(const std::string& url, ResponseConsumer& consumer) {
+        LeasePtr leased = lease();
+        if (!cache) {
+            perform(
+                *leased,
+                [&](RequestSetup& setup) { setup.apply(url, nullptr); }, true,
+                consumer);
+            return;
+        }
+        ResponseCache::Impl& responses = *cache->pimpl;
+
+        ResponseCache::Impl::EntryPtr cached = responses.find(url);
+        if (cached && cached->fresh(ResponseCache::Impl::Clock::now())) {
+            responses.hits++;
+            replay(*cached, consumer);
+            return;
+        }
+
+        CachingConsumer caching(consumer, responses.shard_budget);
+        CURL* curl = perform(
+            *leased,
+            [&](RequestSetup& setup) {
+                setup.apply(url, nullptr);
+                if (cached)
+                    setup.set_validators(cached->etag, cached->last_modified);
+            },
+            true, caching);
+
+        if (cached && caching.status() == 304) {
+            responses.revalidations++;
+            responses.store(url, ResponseCache::Impl::refresh(*cached, curl));
+            replay(*cached, consumer);
+            return;
+        }
+        responses.misses++;
+        if (!caching.kept()) return;
+        if (auto entry = ResponseCache::Impl::describe(
+                curl, caching.status(), std::move(caching.body())))
+            responses.store(url, std::move(entry));
+    }
+
+    // a cached response, delivered as if it had just arrived
+    static void replay(const ResponseCache::Impl::Entry& entry,
+                       ResponseConsumer& consumer) {
+        const std::string& body = *entry.body;
+        consumer.on_start(entry.status, body.size());
+        if (!body.empty() && !consumer.on_data(body))
+            throw std::runtime_error("Response consumer stopped the transfer");
+        consumer.on_complete();
+    }
+
+    void post(const std::string& url, const std::string& body,
+              ResponseConsumer& consumer) {
+        perform(
+            *lease(), [&](RequestSetup& setup) { setup.apply(url, &body); },
+            false, consumer);
+    }
+
+    void send(const HttpRequest& request, ResponseConsumer& consumer) {
+        perform(
+            *lease(), [&](RequestSetup& setup) { setup.apply(request); },
+            repeatable(request), consumer);
     }
 };
 
+namespace {
+
+// the body in a string, reserved from Content-Length
+template <typename Perform>
+std::string collect(Perform perform) {
+    StringConsumer consumer;
+    perform(consumer);
+    return std::move(consumer.body());
+}
+
+} // namespace
+
 HTTPClient::HTTPClient() : pimpl(std::make_unique<Impl>()) {}
 
+HTTPClient::HTTPClient(std::shared_ptr<ConnectionPool> pool)
+    : pimpl(std::make_unique<Impl>(std::move(pool))) {}
+
+HTTPClient::HTTPClient(std::shared_ptr<ConnectionPool> pool,
+                       std::shared_ptr<ResponseCache> cache)
+    : pimpl(std::make_unique<Impl>(std::move(pool), std::move(cache))) {}
+
 HTTPClient::~HTTPClient() = default;
 
 HTTPClient::HTTPClient(HTTPClient&&) noexcept = default;
 HTTPClient& HTTPClient::operator=(HTTPClient&&) noexcept = default;
 
 std::string HTTPClient::get(const std::string& url) {
-    return pimpl->perform(url);
+    return collect(
+        [&](ResponseConsumer& consumer) { pimpl->get(url, consumer); });
 }
 
 std::string HTTPClient::post(const std::string& url, const std::string& body) {
-    return pimpl->perform(url, &body);
+    return collect(
+        [&](ResponseConsumer& consumer) { pimpl->post(url, body, consumer); });
+}
+
+void HTTPClient::get(const std::string& url, ResponseConsumer& consumer) {
+    pimpl->get(url, consumer);
+}
+
+void HTTPClient::post(const std::string& url, const std::string& body,
+                      ResponseConsumer& consumer) {
+    pimpl->post(url, body, consumer);
+}
+
+std::string HTTPClient::send(const HttpRequest& request) {
+    return collect(
+        [&](ResponseConsumer& consumer) { pimpl->send(request, consumer); });
+}
+
+void HTTPClient::send(const HttpRequest& request, ResponseConsumer& consumer) {
+    pimpl->send(request, consumer);
+}
+
+void HTTPClient::set_hedging(std::optional<HedgePolicy> policy) {
+    pimpl->hedging = policy;
+}
+
+void HTTPClient::set_retries(std::optional<RetryPolicy> policy) {
+    pimpl->retries = policy;
+}
+
+void HTTPClient::set_retry_budget(RetryBudget budget) {
+    pimpl->budget = budget;
+    pimpl->tokens.store(budget.max_tokens);
+}
+
+void HTTPClient::set_metrics(std::shared_ptr<TransferMetrics> metrics) {
+    pimpl->metrics = std::move(metrics);
 }
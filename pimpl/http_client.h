@@ -1,12 +1,34 @@
 #ifndef HTTP_CLIENT
 #define HTTP_CLIENT
 
+#include "connection_pool.h"
+#include "request_policy.h"
+#include "response_cache.h"
+#include "response_consumer.h"
+#include "transfer_metrics.h"
 #include <memory>
+#include <optional>
 #include <string>
 
+class HttpRequest;  // builder/request_builder.h
+
+// Blocking requests, safe to make from any number of threads at once: one
+// client can serve a whole thread pool. Each call leases an easy handle from
+// the client's idle ones, without taking a lock, and hands it back warm --
+// options, header lists and keep-alive connections as the last call left
+// them. A thread mostly gets back the handle it used before.
 class HTTPClient {
 public:
     HTTPClient();
+
+    // reuses the pool's DNS answers and TLS sessions; any number of clients
+    // per pool
+    explicit HTTPClient(std::shared_ptr<ConnectionPool> pool);
+
+    // get() answers from `cache` while fresh and revalidates it when stale;
+    // either may be null, and both may be shared with other clients
+    HTTPClient(std::shared_ptr<ConnectionPool> pool,
+               std::shared_ptr<ResponseCache> cache);
     ~HTTPClient();
 
     // no copying
@@ -20,6 +42,32 @@ public:
     std::string get(const std::string& url);
     std::string post(const std::string& url, const std::string& body);
 
+    // the body streamed into `consumer` as it arrives, instead of returned
+    void get(const std::string& url, ResponseConsumer& consumer);
+    void post(const std::string& url, const std::string& body,
+              ResponseConsumer& consumer);
+
+    // a request from HttpRequestBuilder, with its headers, auth, timeouts,
+    // redirect and TLS settings. Options the previous request already set
+    // are not set again, and repeated header sets reuse their curl lists.
+    // A header holding CR, LF or NUL throws std::invalid_argument.
+    std::string send(const HttpRequest& request);
+    void send(const HttpRequest& request, ResponseConsumer& consumer);
+
+    // Opt-in tail latency policies for idempotent requests (request_policy.h):
+    // a slow request is raced by a second copy, a failed one retried after a
+    // jittered backoff. Both take their extra attempts from the budget, which
+    // all threads share. These setters are not to be called with requests in
+    // flight.
+    void set_hedging(std::optional<HedgePolicy> policy);
+    void set_retries(std::optional<RetryPolicy> policy);
+    void set_retry_budget(RetryBudget budget);
+
+    // per-phase timings and byte counts of every transfer, added to
+    // `metrics`; null stops recording. Not to be called with requests in
+    // flight.
+    void set_metrics(std::shared_ptr<TransferMetrics> metrics);
+
 private:
     struct Impl;
     std::unique_ptr<Impl> pimpl;
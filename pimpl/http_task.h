@@ -0,0 +1,131 @@
+#ifndef HTTP_TASK
+#define HTTP_TASK
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// A coroutine returning T, for writing request code that reads sequentially:
+//
+//   HttpTask<std::string> login(AsyncHTTPClient& client) {
+//       std::string token = co_await client.co_post(auth_url, credentials);
+//       co_return co_await client.co_get(profile_url + "?token=" + token);
+//   }
+//
+// It starts running when called and carries on, wherever its awaits resume
+// it, until it finishes. Another HttpTask can co_await it; a plain function
+// blocks on get(). The task must outlive the coroutine -- wait for it before
+// letting it go.
+namespace http_task_detail {
+
+// continuation of a task: none yet, the awaiting coroutine, or DONE
+inline void* const DONE = reinterpret_cast<void*>(1);
+
+struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> self) noexcept {
+        // once DONE, the frame may be destroyed by the task's owner
+        void* awaiting = self.promise().continuation.exchange(DONE);
+        if (awaiting) return std::coroutine_handle<>::from_address(awaiting);
+        return std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+};
+
+struct PromiseBase {
+    std::atomic<void*> continuation{nullptr};
+    std::exception_ptr error;
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+// an eagerly started coroutine that cleans up after itself, for get()
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+} // namespace http_task_detail
+
+template <typename T>
+class HttpTask {
+public:
+    struct promise_type : http_task_detail::PromiseBase {
+        std::optional<T> value;
+
+        HttpTask get_return_object() {
+            return HttpTask(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void return_value(T result) { value.emplace(std::move(result)); }
+    };
+
+    HttpTask(HttpTask&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr)) {}
+    HttpTask& operator=(HttpTask&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~HttpTask() {
+        if (handle) handle.destroy();
+    }
+
+    bool done() const {
+        return handle.promise().continuation.load() == http_task_detail::DONE;
+    }
+
+    // co_await task: the result, or the exception the coroutine ended with
+    bool await_ready() const { return done(); }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        void* expected = nullptr;
+        // false if the task finished meanwhile: resume without suspending
+        return handle.promise().continuation.compare_exchange_strong(
+            expected, awaiting.address());
+    }
+    T await_resume() {
+        auto& promise = handle.promise();
+        if (promise.error) std::rethrow_exception(promise.error);
+        return std::move(*promise.value);
+    }
+
+    // blocks the calling thread until the coroutine has finished
+    T get() {
+        auto result = std::make_shared<std::promise<T>>();
+        auto future = result->get_future();
+        [](HttpTask& task, std::shared_ptr<std::promise<T>> result)
+            -> http_task_detail::Detached {
+            try {
+                result->set_value(co_await task);
+            } catch (...) {
+                result->set_exception(std::current_exception());
+            }
+        }(*this, result);
+        return future.get();
+    }
+
+private:
+    explicit HttpTask(std::coroutine_handle<promise_type> handle)
+        : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+#endif // HTTP_TASK
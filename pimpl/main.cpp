@@ -1,5 +1,23 @@
+#include "async_http_client.h"
 #include "http_client.h"
+#include "http_task.h"
+#include "request_builder.h"
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+// Sequential-looking code; each co_await frees the loop for other requests
+HttpTask<size_t> fetch_both(AsyncHTTPClient& client) {
+    RequestOptions options;
+    options.timeout = std::chrono::seconds(10);
+    std::string first = co_await client.co_get("https://httpbin.org/uuid",
+                                               options);
+    std::string second = co_await client.co_post("https://httpbin.org/post",
+                                                 first, options);
+    co_return first.size() + second.size();
+}
 
 int main() {
     try {
@@ -16,7 +34,152 @@ int main() {
         std::string postData = "{\"name\": \"test\", \"value\": 42}";
         std::string postResponse = client.post("https://httpbin.org/post", postData);
         std::cout << "POST Response:\n" << postResponse << "\n";
-        
+
+        // A builder request, sent on the same easy handle: only the options
+        // that differ from the previous request are set again
+        std::cout << "\nSending a builder request...\n";
+        auto request = HttpRequestDirector::build_json_api_request(
+            "https://httpbin.org/put", HttpMethod::PUT, postData, "demo-key");
+        std::cout << "PUT Response:\n" << client.send(*request) << "\n";
+
+        // Streamed: each chunk is seen as it arrives, nothing is kept
+        std::cout << "\nStreaming 64 KiB from httpbin.org...\n";
+        size_t streamed = 0;
+        size_t chunks = 0;
+        ChunkConsumer counter([&](std::string_view chunk) {
+            streamed += chunk.size();
+            ++chunks;
+            return true;
+        });
+        client.get("https://httpbin.org/bytes/65536", counter);
+        std::cout << "Streamed " << streamed << " bytes in " << chunks
+                  << " chunks\n";
+
+        // A copy of a GET still silent after 200 ms is raced by a second
+        // one, and 502/503/504s and dropped connections are retried
+        std::cout << "\nA GET with hedging and retries...\n";
+        HTTPClient resilient;
+        HedgePolicy hedging;
+        hedging.delay = std::chrono::milliseconds(200);
+        resilient.set_hedging(hedging);
+        resilient.set_retries(RetryPolicy{});
+        try {
+            std::cout << "Received "
+                      << resilient.get("https://httpbin.org/get").size()
+                      << " bytes\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Resilient GET error: " << e.what() << std::endl;
+        }
+
+        // Cached: the second GET is served from memory while the response
+        // is fresh, or revalidated with a conditional request once stale
+        std::cout << "\nTwo GETs through a response cache...\n";
+        auto cache = std::make_shared<ResponseCache>();
+        HTTPClient cached_client(nullptr, cache);
+        for (int i = 0; i < 2; ++i) {
+            try {
+                cached_client.get("https://httpbin.org/cache/60");
+            } catch (const std::exception& e) {
+                std::cerr << "Cache error: " << e.what() << std::endl;
+            }
+        }
+        ResponseCache::Stats cached = cache->stats();
+        std::cout << "Cache: " << cached.hits << " hits, " << cached.misses
+                  << " misses, " << cached.revalidations
+                  << " revalidations, " << cached.bytes << " bytes\n";
+
+        // One client for all workers; each call leases an easy handle, and
+        // the handles share DNS and TLS sessions through a pool, each keeping
+        // its own connections
+        std::cout << "\nFour workers sharing a client...\n";
+        auto pool = std::make_shared<ConnectionPool>();
+        HTTPClient shared_client(pool);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 4; ++i) {
+            workers.emplace_back([&shared_client] {
+                for (int j = 0; j < 3; ++j) {
+                    try {
+                        shared_client.get("https://httpbin.org/get");
+                    } catch (const std::exception& e) {
+                        std::cerr << "Worker error: " << e.what() << std::endl;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        ConnectionPool::Stats stats = pool->stats();
+        std::cout << "Pool: " << stats.hits << " reused, " << stats.misses
+                  << " new, " << stats.idle_connections << " idle of "
+                  << stats.open_connections << " open connections\n";
+
+        // The same requests in flight together, on one event loop thread
+        std::cout << "\nTwelve requests on the async client...\n";
+        AsyncHTTPClient async_client(pool);
+        auto metrics = std::make_shared<TransferMetrics>();
+        async_client.set_metrics(metrics);
+        std::vector<std::future<std::string>> responses;
+        for (int i = 0; i < 12; ++i)
+            responses.push_back(async_client.get("https://httpbin.org/get"));
+        size_t received = 0;
+        for (auto& response : responses) {
+            try {
+                received += response.get().size();
+            } catch (const std::exception& e) {
+                std::cerr << "Async error: " << e.what() << std::endl;
+            }
+        }
+        std::cout << "Received " << received << " bytes\n";
+
+        // A batch: at most 8 in flight, 4 to one host, results in order
+        std::cout << "\nA batch of 20 requests...\n";
+        std::vector<std::string> urls;
+        for (int i = 0; i < 20; ++i)
+            urls.push_back("https://httpbin.org/anything/" + std::to_string(i));
+        BatchOptions batch;
+        batch.max_in_flight = 8;
+        batch.max_per_host = 4;
+        size_t failed = 0;
+        async_client.get_all(
+            urls, [&](BatchResult& result) { failed += result.error != nullptr; },
+            batch);
+        std::cout << urls.size() - failed << " of " << urls.size()
+                  << " succeeded\n";
+
+        // A file in four ranges at once, written straight to disk
+        std::cout << "\nA ranged download...\n";
+        try {
+            DownloadOptions download;
+            download.range_bytes = 64 * 1024;
+            DownloadResult result = async_client.download(
+                "https://httpbin.org/range/262144", "range.bin", download);
+            std::cout << result.bytes << " bytes in " << result.ranges
+                      << " ranges\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Download error: " << e.what() << std::endl;
+        }
+
+        // Where the time went, per host
+        for (const auto& host : metrics->snapshot()) {
+            using Phase = TransferMetrics::Phase;
+            std::cout << host.host << ": " << host.transfers
+                      << " transfers, connect p50 "
+                      << host.phase(Phase::CONNECT).percentile(0.5).count()
+                      << " us, first byte p50 "
+                      << host.phase(Phase::FIRST_BYTE).percentile(0.5).count()
+                      << " us, total p99 "
+                      << host.phase(Phase::TOTAL).percentile(0.99).count()
+                      << " us\n";
+        }
+
+        std::cout << "\nTwo requests in a coroutine...\n";
+        try {
+            std::cout << "Received " << fetch_both(async_client).get()
+                      << " bytes\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Coroutine error: " << e.what() << std::endl;
+        }
+
         return 0;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -0,0 +1,244 @@
+#include "range_download.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+// the progress file: this header, then each range's done count
+struct ProgressHeader {
+    char magic[8];
+    uint64_t total;
+    uint64_t range_bytes;
+    char validator[232];  // NUL-padded
+};
+
+constexpr char PROGRESS_MAGIC[8] = {'R', 'A', 'N', 'G', 'E', 'D', 'L', '1'};
+
+[[noreturn]] void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void write_all(int fd, const char* data, size_t size, uint64_t offset,
+               const std::string& path) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fail("Failed to write " + path);
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+// the space up front, so ranges landing out of order do not fragment the
+// file; where fallocate is not supported, the size alone
+void preallocate(int fd, uint64_t size, const std::string& path) {
+    if (::ftruncate(fd, 0) != 0) fail("Failed to truncate " + path);
+    if (size == 0) return;
+    int error = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+    if (error == EOPNOTSUPP || error == EINVAL) {
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            fail("Failed to size " + path);
+    } else if (error != 0) {
+        errno = error;
+        fail("Failed to allocate " + path);
+    }
+}
+
+} // namespace
+
+RangeFile::RangeFile(const std::string& path)
+    : path(path), progress_path(path + ".progress") {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) fail("Failed to open " + path);
+}
+
+RangeFile::~RangeFile() {
+    if (progress_fd >= 0) ::close(progress_fd);
+    ::close(fd);
+}
+
+uint64_t RangeFile::prepare(uint64_t size, uint64_t bytes_per_range,
+                            const std::string& validator, bool resume) {
+    total = size;
+    range_bytes = bytes_per_range;
+    size_t count = static_cast<size_t>((total + range_bytes - 1) / range_bytes);
+    done.assign(count, 0);
+    persisted.assign(count, 0);
+
+    // without a validator, bytes on disk cannot be told from a newer version
+    if (resume && !validator.empty() && load_progress(validator)) {
+        uint64_t resumed = 0;
+        for (uint64_t bytes : done) resumed += bytes;
+        return resumed;
+    }
+
+    preallocate(fd, total, path);
+    if (resume && !validator.empty()) create_progress(validator);
+    return 0;
+}
+
+void RangeFile::prepare_whole(size_t length) {
+    done.assign(1, 0);
+    persisted.assign(1, 0);
+    range_bytes = 0;  // marks the file as one range of unknown length
+    total = length == ResponseConsumer::UNKNOWN_LENGTH ? 0 : length;
+    preallocate(fd, total, path);
+    ::unlink(progress_path.c_str());  // from an earlier, ranged attempt
+}
+
+uint64_t RangeFile::range_start(size_t range) const {
+    return range * range_bytes;
+}
+
+uint64_t RangeFile::range_length(size_t range) const {
+    return std::min(range_bytes, total - range_start(range));
+}
+
+void RangeFile::write(size_t range, std::string_view chunk) {
+    if (range_bytes && chunk.size() > range_length(range) - done[range])
+        throw std::runtime_error("Range response longer than the range");
+    write_all(fd, chunk.data(), chunk.size(), range_start(range) + done[range],
+              path);
+    done[range] += chunk.size();
+
+    bool complete = range_bytes && done[range] == range_length(range);
+    if (complete || done[range] - persisted[range] >= PROGRESS_STEP)
+        persist(range);
+}
+
+void RangeFile::save_progress() {
+    for (size_t range = 0; range < done.size(); ++range)
+        if (done[range] != persisted[range]) persist(range);
+}
+
+void RangeFile::finish() {
+    // a response without Content-Length may end short of the preallocation
+    if (!range_bytes && ::ftruncate(fd, static_cast<off_t>(done[0])) != 0)
+        fail("Failed to size " + path);
+    if (progress_fd >= 0) {
+        ::close(progress_fd);
+        progress_fd = -1;
+        ::unlink(progress_path.c_str());
+    }
+}
+
+bool RangeFile::load_progress(const std::string& validator) {
+    int progress = ::open(progress_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (progress < 0) return false;
+
+    ProgressHeader header{};
+    size_t counts = done.size() * sizeof(uint64_t);
+    struct stat file{};
+    bool matches =
+        ::pread(progress, &header, sizeof(header), 0) ==
+            static_cast<ssize_t>(sizeof(header)) &&
+        std::memcmp(header.magic, PROGRESS_MAGIC, sizeof(PROGRESS_MAGIC)) ==
+            0 &&
+        header.total == total && header.range_bytes == range_bytes &&
+        validator.size() < sizeof(header.validator) &&
+        validator == header.validator &&
+        ::pread(progress, done.data(), counts, sizeof(header)) ==
+            static_cast<ssize_t>(counts) &&
+        ::fstat(fd, &file) == 0 && static_cast<uint64_t>(file.st_size) == total;
+    for (size_t range = 0; matches && range < done.size(); ++range)
+        matches = done[range] <= range_length(range);
+
+    if (!matches) {
+        ::close(progress);
+        std::fill(done.begin(), done.end(), 0);
+        return false;
+    }
+    progress_fd = progress;
+    persisted = done;
+    return true;
+}
+
+void RangeFile::create_progress(const std::string& validator) {
+    // a validator too long to record is not worth resuming with
+    ProgressHeader header{};
+    if (validator.size() >= sizeof(header.validator)) return;
+
+    progress_fd = ::open(progress_path.c_str(),
+                         O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (progress_fd < 0) fail("Failed to create " + progress_path);
+    std::memcpy(header.magic, PROGRESS_MAGIC, sizeof(PROGRESS_MAGIC));
+    header.total = total;
+    header.range_bytes = range_bytes;
+    validator.copy(header.validator, validator.size());
+    write_all(progress_fd, reinterpret_cast<const char*>(&header),
+              sizeof(header), 0, progress_path);
+    write_all(progress_fd, reinterpret_cast<const char*>(done.data()),
+              done.size() * sizeof(uint64_t), sizeof(header), progress_path);
+}
+
+// after the data: a crash between the two costs a re-download, not a hole
+void RangeFile::persist(size_t range) {
+    persisted[range] = done[range];
+    if (progress_fd < 0) return;
+    uint64_t offset = sizeof(ProgressHeader) + range * sizeof(uint64_t);
+    write_all(progress_fd, reinterpret_cast<const char*>(&done[range]),
+              sizeof(uint64_t), offset, progress_path);
+}
+
+void RangeConsumer::on_start(long status, size_t) {
+    if (status == 200)
+        throw std::runtime_error("Resource changed during the download");
+    if (status != 206)
+        throw std::runtime_error("Range request failed with HTTP " +
+                                 std::to_string(status));
+}
+
+bool RangeConsumer::on_data(std::string_view chunk) {
+    file.write(range, chunk);
+    return true;
+}
+
+void ProbeConsumer::on_start(long response_status, size_t content_length) {
+    status = response_status;
+    if (status == 200) {
+        file.prepare_whole(content_length);
+        return;
+    }
+    if (status != 206 && status != 416)
+        throw std::runtime_error("Download failed with HTTP " +
+                                 std::to_string(status));
+
+    // "bytes 0-0/12345", or "bytes */0" for an empty resource (416)
+    curl_header* range = nullptr;
+    if (curl_easy_header(curl, "Content-Range", 0, CURLH_HEADER, -1,
+                         &range) != CURLHE_OK)
+        throw std::runtime_error("Range response without Content-Range");
+    std::string_view value = range->value;
+    size_t slash = value.rfind('/');
+    auto digits = value.substr(slash == std::string_view::npos ? value.size()
+                                                               : slash + 1);
+    auto [end, error] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), size);
+    if (digits.empty() || error != std::errc())
+        throw std::runtime_error("Range response of unknown size");
+
+    // If-Range takes strong validators only
+    curl_header* found = nullptr;
+    if (curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &found) ==
+            CURLHE_OK &&
+        std::strncmp(found->value, "W/", 2) != 0)
+        strong_validator = found->value;
+    else if (curl_easy_header(curl, "Last-Modified", 0, CURLH_HEADER, -1,
+                              &found) == CURLHE_OK)
+        strong_validator = found->value;
+}
+
+bool ProbeConsumer::on_data(std::string_view chunk) {
+    if (status == 200) file.write(0, chunk);
+    return true;  // the probe's byte is fetched again with its range
+}
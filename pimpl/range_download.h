@@ -0,0 +1,105 @@
+#ifndef RANGE_DOWNLOAD
+#define RANGE_DOWNLOAD
+
+// Private to the httpclient library: the file side of
+// AsyncHTTPClient::download.
+
+#include "response_consumer.h"
+#include <cstdint>
+#include <curl/curl.h>
+#include <string>
+#include <vector>
+
+// The output file of a download, preallocated and written with pwrite at
+// each range's offset. Alongside it, `path`.progress records how much of
+// every range is on disk, so that a failed download can be resumed: it is
+// written at least every PROGRESS_STEP bytes of a range, and removed once
+// the download is complete.
+class RangeFile {
+public:
+    static constexpr uint64_t PROGRESS_STEP = 1024 * 1024;
+
+    explicit RangeFile(const std::string& path);
+    ~RangeFile();
+
+    RangeFile(const RangeFile&) = delete;
+    RangeFile& operator=(const RangeFile&) = delete;
+
+    // For a server that does ranges: splits `total` bytes into ranges and
+    // preallocates the file. With `resume`, progress recorded for the same
+    // size and validator is picked up; returns the bytes it covers.
+    uint64_t prepare(uint64_t total, uint64_t range_bytes,
+                     const std::string& validator, bool resume);
+
+    // for one that does not: a single range, `length` if it is known
+    void prepare_whole(size_t length);
+
+    size_t ranges() const { return done.size(); }
+    uint64_t range_start(size_t range) const;
+    uint64_t range_length(size_t range) const;
+    uint64_t range_done(size_t range) const { return done[range]; }
+
+    // the next bytes of `range`
+    void write(size_t range, std::string_view chunk);
+
+    // the progress so far, for a resume
+    void save_progress();
+
+    // all ranges written: drops the progress file
+    void finish();
+
+private:
+    std::string path;
+    std::string progress_path;
+    int fd = -1;
+    int progress_fd = -1;
+    uint64_t total = 0;
+    uint64_t range_bytes = 0;
+    std::vector<uint64_t> done;       // bytes of each range on disk
+    std::vector<uint64_t> persisted;  // as the progress file has them
+
+    bool load_progress(const std::string& validator);
+    void create_progress(const std::string& validator);
+    void persist(size_t range);
+};
+
+// Feeds one range of the response into the file; any answer but a 206
+// fails the transfer -- a 200 means the resource changed (If-Range).
+class RangeConsumer : public ResponseConsumer {
+public:
+    RangeConsumer(RangeFile& file, size_t range) : file(file), range(range) {}
+
+    void on_start(long status, size_t content_length) override;
+    bool on_data(std::string_view chunk) override;
+
+private:
+    RangeFile& file;
+    size_t range;
+};
+
+// The first request of a download, for "bytes=0-0": a 206 tells the size
+// and validator, and a 200 from a server without ranges is the whole file,
+// written as it comes.
+class ProbeConsumer : public ResponseConsumer {
+public:
+    explicit ProbeConsumer(RangeFile& file) : file(file) {}
+
+    // the transfer's handle, for the response headers
+    void attach(CURL* handle) { curl = handle; }
+
+    void on_start(long status, size_t content_length) override;
+    bool on_data(std::string_view chunk) override;
+
+    bool ranged() const { return status == 206 || status == 416; }
+    uint64_t total() const { return size; }
+    const std::string& validator() const { return strong_validator; }
+
+private:
+    RangeFile& file;
+    CURL* curl = nullptr;
+    long status = 0;
+    uint64_t size = 0;
+    std::string strong_validator;  // ETag, else Last-Modified
+};
+
+#endif // RANGE_DOWNLOAD
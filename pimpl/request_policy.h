@@ -0,0 +1,39 @@
+#ifndef REQUEST_POLICY
+#define REQUEST_POLICY
+
+#include <chrono>
+#include <cstddef>
+
+// Policies HTTPClient applies to idempotent requests (get, and send of GET,
+// HEAD, PUT, DELETE or OPTIONS with a contiguous body), all off by default.
+
+// Send a second copy of a request that has not started responding after
+// `delay` -- or, when `delay` is 0, after the `percentile` of the client's
+// recent times to first byte, once `min_samples` of them are known. The
+// first copy to respond is the one delivered; the other is cancelled.
+struct HedgePolicy {
+    std::chrono::milliseconds delay{0};
+    double percentile = 0.95;
+    size_t min_samples = 20;
+};
+
+// Retry failures that delivered nothing: connection failures, timeouts,
+// dropped connections, and 502, 503 and 504 responses. Waits between
+// attempts are drawn at random up to base_backoff, doubling each time
+// ("full jitter"), capped at max_backoff.
+struct RetryPolicy {
+    int max_attempts = 3;  // the first one included
+    std::chrono::milliseconds base_backoff{50};
+    std::chrono::milliseconds max_backoff{2000};
+};
+
+// What retries and hedges may cost together, as a token bucket: each request
+// adds `ratio` of a token, up to `max_tokens`, and each extra attempt takes a
+// whole one. When a backend fails under load, the client then adds at most
+// `ratio` more traffic, not max_attempts times as much.
+struct RetryBudget {
+    double ratio = 0.1;
+    double max_tokens = 10;
+};
+
+#endif // REQUEST_POLICY
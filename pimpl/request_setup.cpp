@@ -0,0 +1,239 @@
+#include "request_setup.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+// set with CURLOPT_CUSTOMREQUEST; curl has its own options for the rest
+const char* custom_method(HttpMethod method) {
+    switch (method) {
+        case HttpMethod::PUT: return "PUT";
+        case HttpMethod::DELETE: return "DELETE";
+        case HttpMethod::PATCH: return "PATCH";
+        case HttpMethod::OPTIONS: return "OPTIONS";
+        case HttpMethod::GET:
+        case HttpMethod::POST:
+        case HttpMethod::HEAD: break;
+    }
+    return nullptr;
+}
+
+void check_header_text(std::string_view text, std::string_view forbidden,
+                       const char* what) {
+    if (text.find_first_of(forbidden) != std::string_view::npos)
+        throw std::invalid_argument(std::string(what) +
+                                    " holds a character not allowed there");
+}
+
+} // namespace
+
+RequestSetup::~RequestSetup() {
+    for (auto& set : header_sets) curl_slist_free_all(set.list);
+}
+
+void RequestSetup::apply(const HttpRequest& request) {
+    url = request.build_full_url();
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+
+    Options options;
+    options.method = request.get_method();
+    options.connect_timeout_ms =
+        static_cast<long>(request.get_connect_timeout().count());
+    // curl has no read timeout as such: abort below 1 byte/s for that long
+    options.low_speed_time = static_cast<long>(
+        std::chrono::ceil<std::chrono::seconds>(request.get_read_timeout())
+            .count());
+    options.follow_redirects = request.should_follow_redirects();
+    options.max_redirects = request.get_max_redirects();
+    options.verify_ssl = request.should_verify_ssl();
+
+    apply_options(options);
+    clear_range();
+    apply_headers(&request.get_headers());
+    apply_body(options.method, &request.get_body(), nullptr);
+}
+
+void RequestSetup::apply(const std::string& plain_url,
+                         const std::string* body) {
+    url = plain_url;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+
+    Options options;
+    options.method = body ? HttpMethod::POST : HttpMethod::GET;
+    apply_options(options);
+    clear_range();
+    apply_headers(nullptr);
+    apply_body(options.method, nullptr, body);
+}
+
+void RequestSetup::apply_options(const Options& options) {
+    bool all = !applied;
+    if (!all && *applied == options) return;
+
+    if (all || applied->method != options.method)
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST,
+                         custom_method(options.method));
+    if (all || applied->connect_timeout_ms != options.connect_timeout_ms)
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS,
+                         options.connect_timeout_ms);
+    if (all || applied->low_speed_time != options.low_speed_time) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
+                         options.low_speed_time > 0 ? 1L : 0L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME,
+                         options.low_speed_time);
+    }
+    if (all || applied->follow_redirects != options.follow_redirects)
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION,
+                         options.follow_redirects ? 1L : 0L);
+    if (all || applied->max_redirects != options.max_redirects)
+        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, options.max_redirects);
+    if (all || applied->verify_ssl != options.verify_ssl) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER,
+                         options.verify_ssl ? 1L : 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST,
+                         options.verify_ssl ? 2L : 0L);
+    }
+    applied = options;
+}
+
+void RequestSetup::apply_headers(const Headers* headers) {
+    // curl works out the length of what it sends
+    header_key.clear();
+    header_ends.clear();
+    if (headers) {
+        for (const auto& entry : *headers) {
+            if (entry.id == HeaderName::CONTENT_LENGTH) continue;
+            add_header(entry.name(), entry.value);
+        }
+    }
+    use_header_key();
+}
+
+void RequestSetup::add_header(std::string_view name, std::string_view value) {
+    using namespace std::string_view_literals;
+    check_header_text(name, "\r\n\0 "sv, "Header name");
+    check_header_text(value, "\r\n\0"sv, "Header value");
+
+    header_key.append(name);
+    // "Name;" is how curl is told to send a header with no value
+    if (value.empty())
+        header_key.append(";");
+    else
+        header_key.append(": ").append(value);
+    header_ends.push_back(header_key.size());
+}
+
+void RequestSetup::set_validators(std::string_view etag,
+                                  std::string_view last_modified) {
+    // header_key still holds what apply() set: the validators go after it
+    if (!etag.empty()) add_header("If-None-Match", etag);
+    if (!last_modified.empty()) add_header("If-Modified-Since", last_modified);
+    use_header_key();
+}
+
+void RequestSetup::set_range(uint64_t first, uint64_t last,
+                             std::string_view validator) {
+    range = std::to_string(first) + "-" + std::to_string(last);
+    curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+
+    if (!validator.empty()) add_header("If-Range", validator);
+    use_header_key();
+}
+
+void RequestSetup::clear_range() {
+    if (range.empty()) return;
+    curl_easy_setopt(curl, CURLOPT_RANGE, nullptr);
+    range.clear();
+}
+
+void RequestSetup::use_header_key() {
+    curl_slist* list = nullptr;
+    if (!header_key.empty()) {
+        auto found = std::find_if(header_sets.begin(), header_sets.end(),
+                                  [this](const HeaderSet& set) {
+                                      return set.key == header_key &&
+                                             set.ends == header_ends;
+                                  });
+
+        if (found != header_sets.end()) {
+            std::rotate(header_sets.begin(), found, found + 1);
+        } else {
+            HeaderSet set;
+            set.key = header_key;
+            set.ends = header_ends;
+            std::string line;
+            size_t start = 0;
+            for (size_t end : header_ends) {
+                line.assign(header_key, start, end - start);
+                set.list = curl_slist_append(set.list, line.c_str());
+                start = end;
+            }
+
+            if (header_sets.size() == MAX_CACHED_HEADER_SETS) {
+                curl_slist_free_all(header_sets.back().list);
+                header_sets.pop_back();
+            }
+            header_sets.insert(header_sets.begin(), std::move(set));
+        }
+        list = header_sets.front().list;
+    }
+
+    if (list != applied_headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
+        applied_headers = list;
+    }
+}
+
+void RequestSetup::apply_body(HttpMethod method, const RequestBody* owned,
+                              const std::string* plain) {
+    bool sends_body = false;
+    if (method != HttpMethod::GET && method != HttpMethod::HEAD) {
+        if (plain)
+            sends_body = true;
+        else
+            sends_body = method == HttpMethod::POST ||
+                         method == HttpMethod::PUT ||
+                         method == HttpMethod::PATCH || !owned->empty();
+    }
+
+    // both reset CURLOPT_NOBODY, so HEAD is set again every time
+    if (!sends_body) {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        if (method == HttpMethod::HEAD)
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        return;
+    }
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+
+    if (plain || owned->is_contiguous()) {
+        std::string_view bytes =
+            plain ? std::string_view(*plain) : owned->view();
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                         static_cast<curl_off_t>(bytes.size()));
+        // sent from the request itself; a null pointer would mean read_cb
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS,
+                         bytes.empty() ? "" : bytes.data());
+        return;
+    }
+
+    // a generated body is pulled through a reader; -1 sends it chunked
+    reader.emplace(owned->reader());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, nullptr);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, &read_cb);
+    curl_easy_setopt(curl, CURLOPT_READDATA, this);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     owned->has_known_length()
+                         ? static_cast<curl_off_t>(owned->length())
+                         : curl_off_t(-1));
+}
+
+size_t RequestSetup::read_cb(char* buffer, size_t size, size_t nitems,
+                             void* userdata) {
+    auto* self = static_cast<RequestSetup*>(userdata);
+    try {
+        return self->reader->read(buffer, size * nitems);
+    } catch (...) {
+        return CURL_READFUNC_ABORT;
+    }
+}
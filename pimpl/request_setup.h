@@ -0,0 +1,86 @@
+#ifndef REQUEST_SETUP
+#define REQUEST_SETUP
+
+// Private to the httpclient library: configures one easy handle for request
+// after request, touching only what changed since the previous one.
+
+#include "request_builder.h"
+#include <cstdint>
+#include <curl/curl.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class RequestSetup {
+public:
+    // header sets kept as ready-made curl_slists
+    static constexpr size_t MAX_CACHED_HEADER_SETS = 8;
+
+    explicit RequestSetup(CURL* curl) : curl(curl) {}
+    ~RequestSetup();
+
+    RequestSetup(const RequestSetup&) = delete;
+    RequestSetup& operator=(const RequestSetup&) = delete;
+
+    // a builder request: method, URL with query, headers (with auth), body,
+    // timeouts, redirects and TLS verification. The request must stay alive
+    // until the transfer is over -- the body is sent from it, not copied.
+    // Throws std::invalid_argument for CR, LF or NUL in a header (or a space
+    // in its name), as curl would send it on as a line of its own.
+    void apply(const HttpRequest& request);
+
+    // a plain GET, or POST of `body`, with curl's defaults for the rest
+    void apply(const std::string& url, const std::string* body);
+
+    // after apply(): makes the request conditional on the cached response's
+    // validators, added to the headers it set (either may be empty)
+    void set_validators(std::string_view etag, std::string_view last_modified);
+
+    // after apply(): asks for bytes `first` to `last` only, and with a
+    // `validator` (ETag or Last-Modified) for all of it if that changed; the
+    // headers apply() set are kept
+    void set_range(uint64_t first, uint64_t last, std::string_view validator);
+
+private:
+    // the options worth comparing before setting
+    struct Options {
+        HttpMethod method = HttpMethod::GET;
+        long connect_timeout_ms = 0;
+        long low_speed_time = 0;  // seconds without a byte; 0: no limit
+        bool follow_redirects = false;
+        long max_redirects = -1;
+        bool verify_ssl = true;
+
+        bool operator==(const Options&) const = default;
+    };
+
+    struct HeaderSet {
+        std::string key;           // "name: value" lines, back to back
+        std::vector<size_t> ends;  // where each line of `key` ends
+        curl_slist* list = nullptr;
+    };
+
+    CURL* curl;
+    std::string url;
+    std::optional<Options> applied;  // none before the first request
+    std::string header_key;          // as last applied; keeps its capacity
+    std::vector<size_t> header_ends;
+    std::vector<HeaderSet> header_sets;  // most recently used first
+    const curl_slist* applied_headers = nullptr;
+    std::optional<RequestBody::Reader> reader;
+    std::string range;  // "first-last", while CURLOPT_RANGE is set
+
+    void apply_options(const Options& options);
+    void clear_range();
+    void apply_headers(const Headers* headers);
+    void add_header(std::string_view name, std::string_view value);
+    void use_header_key();  // header_key, as a cached list
+    void apply_body(HttpMethod method, const RequestBody* owned,
+                    const std::string* plain);
+
+    static size_t read_cb(char* buffer, size_t size, size_t nitems,
+                          void* userdata);
+};
+
+#endif // REQUEST_SETUP
@@ -0,0 +1,233 @@
+#include "response_cache.h"
+#include "response_cache_impl.h"
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <optional>
+
+namespace {
+
+// list nodes, map slots and the like, on top of what an entry holds
+constexpr size_t ENTRY_OVERHEAD = 128;
+
+// the value of the last `name` header of the response, or ""
+std::string_view header(CURL* curl, const char* name) {
+    curl_header* found = nullptr;
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &found) !=
+        CURLHE_OK)
+        return {};
+    if (found->amount > 1)
+        curl_easy_header(curl, name, found->amount - 1, CURLH_HEADER, -1,
+                         &found);
+    return found->value;
+}
+
+std::string_view trim(std::string_view text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return {};
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+// directive names are case-insensitive; `expected` is lowercase
+bool is_named(std::string_view name, std::string_view expected) {
+    return name.size() == expected.size() &&
+           std::equal(expected.begin(), expected.end(), name.begin(),
+                      [](char wanted, char actual) {
+                          return wanted == (actual | 0x20);
+                      });
+}
+
+std::optional<long long> seconds(std::string_view digits) {
+    long long value = 0;
+    auto [end, error] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (error != std::errc() || end != digits.data() + digits.size())
+        return std::nullopt;
+    return value;
+}
+
+struct Freshness {
+    bool no_store = false;
+    std::optional<std::chrono::seconds> lifetime;  // from now; none: unknown
+};
+
+// RFC 9111 for a private cache: no-store, no-cache and max-age from
+// Cache-Control, less Age; failing max-age, Expires less Date
+Freshness freshness(CURL* curl) {
+    Freshness result;
+    bool no_cache = false;
+    std::optional<long long> max_age;
+
+    size_t count = 1;
+    for (size_t i = 0; i < count; ++i) {
+        curl_header* found = nullptr;
+        if (curl_easy_header(curl, "Cache-Control", i, CURLH_HEADER, -1,
+                             &found) != CURLHE_OK)
+            break;
+        count = found->amount;
+
+        std::string_view value = found->value;
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            std::string_view directive = trim(value.substr(0, comma));
+            value = comma == std::string_view::npos ? std::string_view()
+                                                    : value.substr(comma + 1);
+
+            // name, or name=argument (which may be quoted)
+            size_t equals = directive.find('=');
+            std::string_view name = trim(directive.substr(0, equals));
+            std::string_view argument;
+            if (equals != std::string_view::npos)
+                argument = trim(directive.substr(equals + 1));
+            if (argument.size() >= 2 && argument.front() == '"' &&
+                argument.back() == '"')
+                argument = argument.substr(1, argument.size() - 2);
+
+            if (is_named(name, "no-store"))
+                result.no_store = true;
+            else if (is_named(name, "no-cache"))
+                no_cache = true;
+            else if (is_named(name, "max-age"))
+                max_age = seconds(argument);
+        }
+    }
+
+    if (no_cache) {
+        result.lifetime = std::chrono::seconds(0);  // revalidate every time
+    } else if (max_age) {
+        long long age = seconds(trim(header(curl, "Age"))).value_or(0);
+        result.lifetime = std::chrono::seconds(*max_age - age);
+    } else if (std::string expires(header(curl, "Expires")); !expires.empty()) {
+        // an invalid date means already expired
+        std::string date(header(curl, "Date"));
+        time_t now = date.empty() ? std::time(nullptr)
+                                  : curl_getdate(date.c_str(), nullptr);
+        time_t until = curl_getdate(expires.c_str(), nullptr);
+        result.lifetime = std::chrono::seconds(
+            until < 0 || now < 0 ? 0 : static_cast<long long>(until - now));
+    }
+    if (result.lifetime)
+        result.lifetime = std::max(*result.lifetime, std::chrono::seconds(0));
+    return result;
+}
+
+} // namespace
+
+size_t ResponseCache::Impl::Entry::cost(const std::string& url) const {
+    return url.size() + body->size() + etag.size() + last_modified.size() +
+           ENTRY_OVERHEAD;
+}
+
+ResponseCache::Impl::Impl(Options options)
+    : shards(std::max<size_t>(options.shards, 1)),
+      shard_budget(options.max_bytes / shards.size()) {}
+
+ResponseCache::Impl::Shard& ResponseCache::Impl::shard_of(
+    const std::string& url) {
+    return shards[std::hash<std::string>{}(url) % shards.size()];
+}
+
+ResponseCache::Impl::EntryPtr ResponseCache::Impl::find(
+    const std::string& url) {
+    Shard& shard = shard_of(url);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(url);
+    if (found == shard.index.end()) return nullptr;
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    return found->second->second;
+}
+
+void ResponseCache::Impl::store(const std::string& url, EntryPtr entry) {
+    size_t bytes = entry->cost(url);
+    Shard& shard = shard_of(url);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (auto found = shard.index.find(url); found != shard.index.end()) {
+        // the index key points into the list node: it goes first
+        auto node = found->second;
+        shard.bytes -= node->second->cost(url);
+        shard.index.erase(found);
+        shard.lru.erase(node);
+    }
+    // too large to keep; the outdated entry is gone all the same
+    if (bytes > shard_budget) return;
+
+    shard.lru.emplace_front(url, std::move(entry));
+    shard.index.emplace(shard.lru.front().first, shard.lru.begin());
+    shard.bytes += bytes;
+
+    while (shard.bytes > shard_budget) {
+        auto& [oldest_url, oldest] = shard.lru.back();
+        shard.bytes -= oldest->cost(oldest_url);
+        shard.index.erase(oldest_url);
+        shard.lru.pop_back();
+        evictions++;
+    }
+}
+
+ResponseCache::Impl::EntryPtr ResponseCache::Impl::describe(
+    CURL* curl, long status, std::string body) {
+    if (status != 200) return nullptr;
+    Freshness fresh = freshness(curl);
+    if (fresh.no_store) return nullptr;
+
+    auto entry = std::make_shared<Entry>();
+    entry->etag = header(curl, "ETag");
+    entry->last_modified = header(curl, "Last-Modified");
+    // neither served nor revalidated: not worth keeping
+    bool servable = fresh.lifetime > std::chrono::seconds(0);
+    if (!servable && entry->etag.empty() && entry->last_modified.empty())
+        return nullptr;
+
+    entry->status = status;
+    entry->body = std::make_shared<const std::string>(std::move(body));
+    entry->expires = Clock::now() + fresh.lifetime.value_or(
+                                        std::chrono::seconds(0));
+    return entry;
+}
+
+ResponseCache::Impl::EntryPtr ResponseCache::Impl::refresh(const Entry& stale,
+                                                           CURL* curl) {
+    auto entry = std::make_shared<Entry>(stale);
+    // a 304 carries the headers a 200 would have, validators included
+    if (std::string_view etag = header(curl, "ETag"); !etag.empty())
+        entry->etag = etag;
+    if (std::string_view modified = header(curl, "Last-Modified");
+        !modified.empty())
+        entry->last_modified = modified;
+    entry->expires = Clock::now() + freshness(curl).lifetime.value_or(
+                                        std::chrono::seconds(0));
+    return entry;
+}
+
+void ResponseCache::Impl::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+ResponseCache::ResponseCache() : ResponseCache(Options{}) {}
+
+ResponseCache::ResponseCache(Options options)
+    : pimpl(std::make_unique<Impl>(options)) {}
+
+ResponseCache::~ResponseCache() = default;
+
+ResponseCache::Stats ResponseCache::stats() const {
+    Stats stats{pimpl->hits.load(), pimpl->misses.load(),
+                pimpl->revalidations.load(), pimpl->evictions.load(), 0, 0};
+    for (auto& shard : pimpl->shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.lru.size();
+        stats.bytes += shard.bytes;
+    }
+    return stats;
+}
+
+void ResponseCache::clear() {
+    pimpl->clear();
+}
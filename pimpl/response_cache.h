@@ -0,0 +1,58 @@
+#ifndef RESPONSE_CACHE
+#define RESPONSE_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// GET responses kept in memory, shared by any number of HTTPClients on any
+// number of threads. A fresh response (Cache-Control max-age, or Expires) is
+// served without any I/O; a stale one is revalidated with If-None-Match /
+// If-Modified-Since, and a 304 reuses the cached body instead of sending it
+// again.
+//
+//   auto cache = std::make_shared<ResponseCache>();
+//   HTTPClient client(nullptr, cache);
+//   client.get(url);  // from the server
+//   client.get(url);  // from memory, while fresh
+//
+// Only 200 responses with a freshness lifetime or a validator are stored,
+// and never those marked no-store. Entries are kept in shards, each an LRU
+// list with its own lock and an equal part of the byte budget.
+class ResponseCache {
+public:
+    struct Options {
+        size_t max_bytes = 64 * 1024 * 1024;  // bodies, URLs and validators
+        size_t shards = 16;
+    };
+
+    struct Stats {
+        uint64_t hits;           // served fresh from memory
+        uint64_t misses;         // fetched in full
+        uint64_t revalidations;  // stale, confirmed by a 304
+        uint64_t evictions;      // dropped to stay within max_bytes
+        uint64_t entries;
+        uint64_t bytes;
+    };
+
+    ResponseCache();
+    explicit ResponseCache(Options options);
+    ~ResponseCache();
+
+    // shared by pointer, never copied or moved
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    Stats stats() const;
+
+    // drops every entry; the counters are kept
+    void clear();
+
+private:
+    friend class HTTPClient;
+
+    struct Impl;  // response_cache_impl.h
+    std::unique_ptr<Impl> pimpl;
+};
+
+#endif // RESPONSE_CACHE
@@ -0,0 +1,80 @@
+#ifndef RESPONSE_CACHE_IMPL
+#define RESPONSE_CACHE_IMPL
+
+// Private to the httpclient library: what HTTPClient::Impl needs to see of
+// the cache. Not installed, and never included by clients.
+
+#include "response_cache.h"
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct ResponseCache::Impl {
+    using Clock = std::chrono::steady_clock;
+
+    // immutable once stored: readers keep using it after the lock is gone
+    struct Entry {
+        long status = 0;
+        std::shared_ptr<const std::string> body;  // shared by revalidations
+        std::string etag;
+        std::string last_modified;
+        Clock::time_point expires;  // fresh until then
+
+        bool fresh(Clock::time_point now) const { return now < expires; }
+
+        // what it counts for against the budget, stored under `url`
+        size_t cost(const std::string& url) const;
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    struct Shard {
+        using Node = std::pair<std::string, EntryPtr>;  // URL and entry
+
+        std::mutex mutex;
+        std::list<Node> lru;  // most recently used first
+        // keys view the URLs in the list, whose nodes never move
+        std::unordered_map<std::string_view, std::list<Node>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    std::vector<Shard> shards;
+    size_t shard_budget;  // bytes; also the largest entry kept
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> revalidations{0};
+    std::atomic<uint64_t> evictions{0};
+
+    explicit Impl(Options options);
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    // the entry for `url`, fresh or stale, or null
+    EntryPtr find(const std::string& url);
+
+    // replaces any entry for `url`, then evicts down to the budget
+    void store(const std::string& url, EntryPtr entry);
+
+    // The entry a finished transfer on `curl` makes, from its status and
+    // headers, or null when the response must not or cannot be cached.
+    static EntryPtr describe(CURL* curl, long status, std::string body);
+
+    // `stale` again fresh, after a 304 on `curl` with new headers
+    static EntryPtr refresh(const Entry& stale, CURL* curl);
+
+    void clear();
+
+private:
+    Shard& shard_of(const std::string& url);
+};
+
+#endif // RESPONSE_CACHE_IMPL
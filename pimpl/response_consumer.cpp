@@ -0,0 +1,90 @@
+#include "response_consumer.h"
+#include "response_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void StringConsumer::on_start(long, size_t content_length) {
+    received.clear();
+    if (content_length != UNKNOWN_LENGTH)
+        received.reserve(std::min(content_length, MAX_RESERVE));
+}
+
+bool StringConsumer::on_data(std::string_view chunk) {
+    received.append(chunk);
+    return true;
+}
+
+void BufferConsumer::on_start(long, size_t content_length) {
+    written = 0;
+    if (content_length != UNKNOWN_LENGTH && content_length > buffer.size())
+        throw std::length_error("Response body larger than the buffer");
+}
+
+bool BufferConsumer::on_data(std::string_view chunk) {
+    if (chunk.size() > buffer.size() - written)
+        throw std::length_error("Response body larger than the buffer");
+    std::memcpy(buffer.data() + written, chunk.data(), chunk.size());
+    written += chunk.size();
+    return true;
+}
+
+void ResponseStream::attach(CURL* handle, ResponseConsumer* target) {
+    curl = handle;
+    consumer = target;
+    started = false;
+    stopped = false;
+    error = nullptr;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+}
+
+void ResponseStream::start() {
+    started = true;
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_off_t length = -1;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    consumer->on_start(status, length < 0 ? ResponseConsumer::UNKNOWN_LENGTH
+                                          : static_cast<size_t>(length));
+}
+
+// Exceptions must not unwind through curl: they are kept, the transfer is
+// stopped by returning short, and finish() rethrows them.
+size_t ResponseStream::write_cb(char* ptr, size_t size, size_t nmemb,
+                                void* userdata) {
+    auto* self = static_cast<ResponseStream*>(userdata);
+    try {
+        if (!self->started) self->start();
+        if (self->consumer->on_data(std::string_view(ptr, size * nmemb)))
+            return size * nmemb;
+        self->stopped = true;
+    } catch (...) {
+        self->error = std::current_exception();
+    }
+    return 0;
+}
+
+std::exception_ptr ResponseStream::finish_nothrow(CURLcode result) {
+    if (error) return error;
+    if (stopped)
+        return std::make_exception_ptr(
+            std::runtime_error("Response consumer stopped the transfer"));
+    if (result != CURLE_OK)
+        return std::make_exception_ptr(
+            std::runtime_error(curl_easy_strerror(result)));
+
+    try {
+        // an empty body has no chunk to start on
+        if (!started) start();
+        consumer->on_complete();
+    } catch (...) {
+        return std::current_exception();
+    }
+    return nullptr;
+}
+
+void ResponseStream::finish(CURLcode result) {
+    if (std::exception_ptr failure = finish_nothrow(result))
+        std::rethrow_exception(failure);
+}
@@ -0,0 +1,82 @@
+#ifndef RESPONSE_CONSUMER
+#define RESPONSE_CONSUMER
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Receives a response body as it arrives, chunk by chunk, straight from
+// curl's receive buffer -- nothing is accumulated on the way. A download
+// then runs in the consumer's memory, and processing can start with the
+// first chunk.
+//
+// Exceptions thrown from the callbacks fail the request with that exception.
+class ResponseConsumer {
+public:
+    static constexpr size_t UNKNOWN_LENGTH = SIZE_MAX;
+
+    virtual ~ResponseConsumer() = default;
+
+    // once the headers are in, before any data
+    virtual void on_start(long status, size_t content_length) {
+        (void)status;
+        (void)content_length;
+    }
+
+    // a chunk, valid during the call only; false stops the transfer
+    virtual bool on_data(std::string_view chunk) = 0;
+
+    // after the last chunk of a successful transfer
+    virtual void on_complete() {}
+};
+
+// the whole body in a string, reserved from Content-Length when it is sent
+class StringConsumer : public ResponseConsumer {
+public:
+    // a larger Content-Length is not trusted for the reservation
+    static constexpr size_t MAX_RESERVE = 64 * 1024 * 1024;
+
+    void on_start(long status, size_t content_length) override;
+    bool on_data(std::string_view chunk) override;
+
+    std::string& body() { return received; }
+
+private:
+    std::string received;
+};
+
+// the body in a caller's buffer; a body that does not fit fails the request
+// with std::length_error -- as soon as Content-Length says so, if it is sent
+class BufferConsumer : public ResponseConsumer {
+public:
+    explicit BufferConsumer(std::span<char> buffer) : buffer(buffer) {}
+
+    void on_start(long status, size_t content_length) override;
+    bool on_data(std::string_view chunk) override;
+
+    size_t size() const { return written; }
+    std::string_view view() const { return {buffer.data(), written}; }
+
+private:
+    std::span<char> buffer;
+    size_t written = 0;
+};
+
+// every chunk handed to a callable, which returns false to stop
+class ChunkConsumer : public ResponseConsumer {
+public:
+    using Handler = std::function<bool(std::string_view chunk)>;
+
+    explicit ChunkConsumer(Handler handler) : handler(std::move(handler)) {}
+
+    bool on_data(std::string_view chunk) override { return handler(chunk); }
+
+private:
+    Handler handler;
+};
+
+#endif // RESPONSE_CONSUMER
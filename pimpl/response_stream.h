@@ -0,0 +1,38 @@
+#ifndef RESPONSE_STREAM
+#define RESPONSE_STREAM
+
+// Private to the httpclient library: feeds a ResponseConsumer from curl's
+// write callback, for both clients.
+
+#include "response_consumer.h"
+#include <curl/curl.h>
+#include <exception>
+
+class ResponseStream {
+public:
+    ResponseStream() = default;
+
+    // before each transfer on `curl`
+    void attach(CURL* curl, ResponseConsumer* consumer);
+
+    // after the transfer: runs on_complete, or throws why it stopped --
+    // the consumer's exception, or a std::runtime_error for `result`
+    void finish(CURLcode result);
+
+    // the same, as an exception_ptr (null on success), for the async client
+    std::exception_ptr finish_nothrow(CURLcode result);
+
+private:
+    CURL* curl = nullptr;
+    ResponseConsumer* consumer = nullptr;
+    bool started = false;
+    bool stopped = false;  // on_data returned false
+    std::exception_ptr error;
+
+    void start();
+
+    static size_t write_cb(char* ptr, size_t size, size_t nmemb,
+                           void* userdata);
+};
+
+#endif // RESPONSE_STREAM
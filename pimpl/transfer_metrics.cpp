@@ -0,0 +1,174 @@
+#include "transfer_metrics.h"
+#include "host_key.h"
+#include "transfer_metrics_impl.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace {
+
+constexpr auto RELAXED = std::memory_order_relaxed;
+
+// the *_T infos: microseconds, or bytes
+uint64_t large_info(CURL* curl, CURLINFO info) {
+    curl_off_t value = 0;
+    curl_easy_getinfo(curl, info, &value);
+    return value > 0 ? static_cast<uint64_t>(value) : 0;
+}
+
+uint64_t long_info(CURL* curl, CURLINFO info) {
+    long value = 0;
+    curl_easy_getinfo(curl, info, &value);
+    return value > 0 ? static_cast<uint64_t>(value) : 0;
+}
+
+// curl's timings run from the start of the transfer; phases are differences
+uint64_t between(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+} // namespace
+
+// Below 4 us a bucket per microsecond; from there, the top three bits of
+// the value: the doubling it falls in, and which quarter of it.
+size_t TransferMetrics::Histogram::bucket_of(uint64_t microseconds) {
+    if (microseconds < 4) return static_cast<size_t>(microseconds);
+    int top = std::bit_width(microseconds) - 1;  // at least 2
+    size_t quarter = static_cast<size_t>(microseconds >> (top - 2)) & 3;
+    return std::min(static_cast<size_t>(top - 1) * 4 + quarter, BUCKETS - 1);
+}
+
+uint64_t TransferMetrics::Histogram::lower_bound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    return (4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+std::chrono::microseconds TransferMetrics::Histogram::mean() const {
+    return std::chrono::microseconds(count ? sum_us / count : 0);
+}
+
+std::chrono::microseconds TransferMetrics::Histogram::percentile(
+    double fraction) const {
+    if (count == 0) return std::chrono::microseconds(0);
+    auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count));
+    rank = std::min(rank, count - 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += counts[bucket];
+        if (seen > rank)
+            return std::chrono::microseconds(
+                bucket + 1 < BUCKETS ? lower_bound(bucket + 1)
+                                     : lower_bound(bucket));
+    }
+    return std::chrono::microseconds(lower_bound(BUCKETS - 1));
+}
+
+void TransferMetrics::Impl::Counters::add(Phase phase, uint64_t microseconds) {
+    auto index = static_cast<size_t>(phase);
+    buckets[index][Histogram::bucket_of(microseconds)].fetch_add(1, RELAXED);
+    sums_us[index].fetch_add(microseconds, RELAXED);
+}
+
+TransferMetrics::HostStats TransferMetrics::Impl::Counters::read() const {
+    HostStats stats;
+    stats.host = host;
+    stats.transfers = transfers.load(RELAXED);
+    stats.failures = failures.load(RELAXED);
+    stats.bytes_sent = bytes_sent.load(RELAXED);
+    stats.bytes_received = bytes_received.load(RELAXED);
+    for (size_t phase = 0; phase < PHASES; ++phase) {
+        Histogram& histogram = stats.phases[phase];
+        for (size_t bucket = 0; bucket < Histogram::BUCKETS; ++bucket) {
+            histogram.counts[bucket] = buckets[phase][bucket].load(RELAXED);
+            histogram.count += histogram.counts[bucket];
+        }
+        histogram.sum_us = sums_us[phase].load(RELAXED);
+    }
+    return stats;
+}
+
+TransferMetrics::Impl::~Impl() {
+    for (auto& slot : slots) delete slot.load();
+}
+
+// Linear probing from the host's hash. A free slot is claimed by swapping
+// in new counters; a thread that loses the race for it looks at who won.
+TransferMetrics::Impl::Counters& TransferMetrics::Impl::counters(
+    const std::string& host) {
+    Counters* created = nullptr;
+    size_t start = std::hash<std::string>{}(host);
+    for (size_t probe = 0; probe < MAX_HOSTS; ++probe) {
+        auto& slot = slots[(start + probe) % MAX_HOSTS];
+        Counters* found = slot.load(std::memory_order_acquire);
+        if (!found) {
+            if (!created) created = new Counters(host);
+            if (slot.compare_exchange_strong(found, created,
+                                             std::memory_order_acq_rel))
+                return *created;
+        }
+        if (found->host == host) {
+            delete created;
+            return *found;
+        }
+    }
+    delete created;
+    return other;
+}
+
+void TransferMetrics::Impl::record(CURL* curl, CURLcode result) {
+    char* url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    Counters& host = counters(host_key(url ? url : ""));
+
+    host.transfers.fetch_add(1, RELAXED);
+    if (result != CURLE_OK) {
+        host.failures.fetch_add(1, RELAXED);
+        return;
+    }
+
+    host.bytes_sent.fetch_add(
+        long_info(curl, CURLINFO_REQUEST_SIZE) +
+            large_info(curl, CURLINFO_SIZE_UPLOAD_T),
+        RELAXED);
+    host.bytes_received.fetch_add(
+        long_info(curl, CURLINFO_HEADER_SIZE) +
+            large_info(curl, CURLINFO_SIZE_DOWNLOAD_T),
+        RELAXED);
+
+    uint64_t lookup = large_info(curl, CURLINFO_NAMELOOKUP_TIME_T);
+    uint64_t connect = large_info(curl, CURLINFO_CONNECT_TIME_T);
+    uint64_t handshake = large_info(curl, CURLINFO_APPCONNECT_TIME_T);
+    uint64_t sent = large_info(curl, CURLINFO_PRETRANSFER_TIME_T);
+    uint64_t first_byte = large_info(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    uint64_t total = large_info(curl, CURLINFO_TOTAL_TIME_T);
+
+    // a reused connection has no setup to speak of
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects > 0) {
+        host.add(Phase::DNS, lookup);
+        host.add(Phase::CONNECT, between(lookup, connect));
+        if (handshake > 0) host.add(Phase::TLS, between(connect, handshake));
+    }
+    host.add(Phase::FIRST_BYTE, between(sent, first_byte));
+    host.add(Phase::TRANSFER, between(first_byte, total));
+    host.add(Phase::TOTAL, total);
+}
+
+TransferMetrics::TransferMetrics() : pimpl(std::make_unique<Impl>()) {}
+
+TransferMetrics::~TransferMetrics() = default;
+
+std::vector<TransferMetrics::HostStats> TransferMetrics::snapshot() const {
+    std::vector<HostStats> hosts;
+    for (auto& slot : pimpl->slots)
+        if (Impl::Counters* counters = slot.load(std::memory_order_acquire))
+            hosts.push_back(counters->read());
+    if (pimpl->other.transfers.load(RELAXED) > 0)
+        hosts.push_back(pimpl->other.read());
+    std::sort(hosts.begin(), hosts.end(),
+              [](const HostStats& a, const HostStats& b) {
+                  return a.host < b.host;
+              });
+    return hosts;
+}
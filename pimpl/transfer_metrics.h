@@ -0,0 +1,89 @@
+#ifndef TRANSFER_METRICS
+#define TRANSFER_METRICS
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where the time of each request went, per host, from curl's own timings.
+// Shared by any number of clients on any number of threads:
+//
+//   auto metrics = std::make_shared<TransferMetrics>();
+//   client.set_metrics(metrics);
+//   ...
+//   for (const auto& host : metrics->snapshot())
+//       host.phase(TransferMetrics::Phase::FIRST_BYTE).percentile(0.99);
+//
+// Recording takes no lock: hosts are found in a fixed open-addressed table,
+// and every count is a relaxed atomic increment. A snapshot reads the same
+// counters, so it is cheap but not taken at a single instant.
+class TransferMetrics {
+public:
+    enum class Phase {
+        DNS,         // name lookup
+        CONNECT,     // TCP connect
+        TLS,         // handshake, on https connections
+        FIRST_BYTE,  // request sent to first response byte: the server's time
+        TRANSFER,    // first byte to last
+        TOTAL,
+    };
+    static constexpr size_t PHASES = 6;
+
+    // hosts beyond this many are counted together, as "other"
+    static constexpr size_t MAX_HOSTS = 256;
+
+    // Durations on a log scale in microseconds, four buckets per doubling
+    // (each about 19% wide), from 1 us to days.
+    struct Histogram {
+        static constexpr size_t BUCKETS = 160;
+
+        std::array<uint64_t, BUCKETS> counts{};
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+
+        std::chrono::microseconds mean() const;
+
+        // the upper bound of the bucket holding that fraction of samples
+        std::chrono::microseconds percentile(double fraction) const;
+
+        static size_t bucket_of(uint64_t microseconds);
+        static uint64_t lower_bound(size_t bucket);  // in microseconds
+    };
+
+    struct HostStats {
+        std::string host;  // "host:port"
+        uint64_t transfers = 0;
+        uint64_t failures = 0;  // transfer errors; HTTP errors are transfers
+        uint64_t bytes_sent = 0;      // headers and body
+        uint64_t bytes_received = 0;  // headers and body
+        // connection phases count only the transfers that opened one
+        std::array<Histogram, PHASES> phases;
+
+        const Histogram& phase(Phase which) const {
+            return phases[static_cast<size_t>(which)];
+        }
+    };
+
+    TransferMetrics();
+    ~TransferMetrics();
+
+    // shared by pointer, never copied or moved
+    TransferMetrics(const TransferMetrics&) = delete;
+    TransferMetrics& operator=(const TransferMetrics&) = delete;
+
+    // every host seen so far
+    std::vector<HostStats> snapshot() const;
+
+private:
+    friend class HTTPClient;
+    friend class AsyncHTTPClient;
+
+    struct Impl;  // transfer_metrics_impl.h
+    std::unique_ptr<Impl> pimpl;
+};
+
+#endif // TRANSFER_METRICS
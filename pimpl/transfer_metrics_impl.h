@@ -0,0 +1,47 @@
+#ifndef TRANSFER_METRICS_IMPL
+#define TRANSFER_METRICS_IMPL
+
+// Private to the httpclient library: what the clients need to see of the
+// metrics. Not installed, and never included by clients.
+
+#include "transfer_metrics.h"
+#include <atomic>
+#include <curl/curl.h>
+
+struct TransferMetrics::Impl {
+    // one host's counters, only ever incremented
+    struct Counters {
+        const std::string host;
+        std::atomic<uint64_t> transfers{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> bytes_received{0};
+        std::array<std::array<std::atomic<uint64_t>, Histogram::BUCKETS>,
+                   PHASES>
+            buckets{};
+        std::array<std::atomic<uint64_t>, PHASES> sums_us{};
+
+        explicit Counters(std::string host) : host(std::move(host)) {}
+
+        void add(Phase phase, uint64_t microseconds);
+        HostStats read() const;
+    };
+
+    // claimed with a compare-and-swap, never released before the end
+    std::array<std::atomic<Counters*>, MAX_HOSTS> slots{};
+    Counters other{"other"};
+
+    Impl() = default;
+    ~Impl();
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    // after a transfer on `curl` ended with `result`
+    void record(CURL* curl, CURLcode result);
+
+private:
+    Counters& counters(const std::string& host);
+};
+
+#endif // TRANSFER_METRICS_IMPL
@@ -0,0 +1,296 @@
+// Logger benchmark -- caller latency and sustained throughput for 1..N
+// producer threads against null / file / console (and zstd) sinks.
+//
+// One JSON object per scenario is written to --output (default
+// logger_benchmark.jsonl); a readable summary goes to stderr. stdout is left to
+// the console sink.
+//
+//   logger_benchmark [--threads N] [--messages N] [--sinks null,file,console]
+//                    [--output path]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compressing_file_sink.h"
+#include "logger.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned                 max_threads = std::thread::hardware_concurrency( );
+    size_t                   messages    = 20000;  // per producer thread
+    std::vector<std::string> sinks       = {"null", "file", "console"};
+    std::string              output      = "logger_benchmark.jsonl";
+};
+
+// what a producer thread does for each message
+enum class Call { TEXT, KV, FILTERED };
+
+const char* call_name(Call call) {
+    switch (call) {
+        case Call::TEXT:
+            return "text";
+        case Call::KV:
+            return "kv";
+        case Call::FILTERED:
+            return "filtered";
+    }
+    return "unknown";
+}
+
+struct Scenario {
+    std::string sink;
+    unsigned    threads;
+    size_t      message_bytes;
+    Call        call;
+};
+
+struct Result {
+    size_t   messages;
+    double   producer_seconds;   // until the last producer returned
+    double   sustained_seconds;  // until every sink wrote everything
+    uint64_t p50_ns, p90_ns, p99_ns, p999_ns, max_ns;
+    size_t   dropped;
+    double   compression_ratio   = 0.0;  // zstd sink only
+    double   compress_mb_per_sec = 0.0;
+};
+
+bool sink_available(const std::string& name) {
+#ifdef LOGGER_HAS_ZSTD
+    if (name == "zstd") return true;
+#endif
+    return name == "null" || name == "file" || name == "console";
+}
+
+std::shared_ptr<LogSink> make_sink(const std::string& name) {
+    if (name == "null") return std::make_shared<NullSink>( );
+    if (name == "console") return std::make_shared<ConsoleSink>( );
+    if (name == "file") {
+        std::remove("logger_benchmark.log");
+        return std::make_shared<FileSink>("logger_benchmark.log");
+    }
+#ifdef LOGGER_HAS_ZSTD
+    if (name == "zstd") {
+        std::remove("logger_benchmark.log.zst");
+        return std::make_shared<CompressingFileSink>(
+            "logger_benchmark.log.zst");
+    }
+#endif
+    return nullptr;
+}
+
+void produce(Call call, const std::string& payload, size_t count,
+             std::atomic<bool>& start_flag, std::vector<uint32_t>& latencies) {
+    auto& logger = Logger::get_instance( );
+    latencies.reserve(count);
+
+    while (!start_flag.load(std::memory_order_acquire))
+        std::this_thread::yield( );
+
+    for (size_t i = 0; i < count; ++i) {
+        auto start = Clock::now( );
+        switch (call) {
+            case Call::TEXT:
+                logger.info("seq=", i, " ", payload);
+                break;
+            case Call::KV:
+                logger.info_kv("bench", {kv("seq", i), kv("payload", payload)});
+                break;
+            case Call::FILTERED:
+                logger.debug("seq=", i, " ", payload);
+                break;
+        }
+        auto elapsed = Clock::now( ) - start;
+        latencies.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count( )));
+    }
+}
+
+Result run(const Scenario& scenario, size_t messages) {
+    auto& logger = Logger::get_instance( );
+    auto  sink   = make_sink(scenario.sink);
+    logger.add_sink(sink);
+
+    std::string payload(scenario.message_bytes, 'x');
+
+    // warm up queues, allocator and page cache outside the measurement
+    for (size_t i = 0; i < 1000; ++i) logger.info("warmup ", payload);
+    logger.flush( );
+
+    std::vector<std::vector<uint32_t>> latencies(scenario.threads);
+    std::vector<std::thread>           producers;
+    std::atomic<bool>                  start_flag(false);
+
+    for (unsigned t = 0; t < scenario.threads; ++t) {
+        producers.emplace_back(produce, scenario.call, std::cref(payload),
+                               messages, std::ref(start_flag),
+                               std::ref(latencies[t]));
+    }
+
+    auto start = Clock::now( );
+    start_flag.store(true, std::memory_order_release);
+    for (auto& producer : producers) producer.join( );
+    auto produced = Clock::now( );
+    logger.flush( );
+    auto drained = Clock::now( );
+
+    logger.remove_sink(sink);
+
+    std::vector<uint32_t> all;
+    all.reserve(messages * scenario.threads);
+    for (const auto& per_thread : latencies)
+        all.insert(all.end( ), per_thread.begin( ), per_thread.end( ));
+    std::sort(all.begin( ), all.end( ));
+
+    auto percentile = [&all](double p) -> uint64_t {
+        if (all.empty( )) return 0;
+        return all[std::min(all.size( ) - 1,
+                            static_cast<size_t>(p * all.size( )))];
+    };
+
+    Result result{ };
+    result.messages = all.size( );
+    result.producer_seconds =
+        std::chrono::duration<double>(produced - start).count( );
+    result.sustained_seconds =
+        std::chrono::duration<double>(drained - start).count( );
+    result.p50_ns  = percentile(0.50);
+    result.p90_ns  = percentile(0.90);
+    result.p99_ns  = percentile(0.99);
+    result.p999_ns = percentile(0.999);
+    result.max_ns  = all.empty( ) ? 0 : all.back( );
+    result.dropped = sink->get_dropped( );
+
+#ifdef LOGGER_HAS_ZSTD
+    // the sink closes its last frame on destruction; the few bytes that adds
+    // do not move the ratio
+    if (auto zstd = std::dynamic_pointer_cast<CompressingFileSink>(sink)) {
+        result.compression_ratio   = zstd->get_compression_ratio( );
+        result.compress_mb_per_sec = zstd->get_throughput_mb_per_sec( );
+    }
+#endif
+
+    return result;
+}
+
+std::string to_json(const Scenario& scenario, const Result& result) {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(1) << "{\"sink\":\""
+         << scenario.sink << "\",\"call\":\"" << call_name(scenario.call)
+         << "\",\"threads\":" << scenario.threads
+         << ",\"message_bytes\":" << scenario.message_bytes
+         << ",\"messages\":" << result.messages << ",\"producer_msgs_per_sec\":"
+         << result.messages / result.producer_seconds
+         << ",\"sustained_msgs_per_sec\":"
+         << result.messages / result.sustained_seconds
+         << ",\"p50_ns\":" << result.p50_ns << ",\"p90_ns\":" << result.p90_ns
+         << ",\"p99_ns\":" << result.p99_ns << ",\"p999_ns\":" << result.p999_ns
+         << ",\"max_ns\":" << result.max_ns
+         << ",\"dropped\":" << result.dropped;
+    if (result.compression_ratio > 0.0)
+        json << ",\"compress_mb_per_sec\":" << result.compress_mb_per_sec
+             << std::setprecision(2)
+             << ",\"compression_ratio\":" << result.compression_ratio;
+    json << "}";
+    return json.str( );
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag  = argv[i];
+        std::string value = argv[i + 1];
+
+        if (flag == "--threads") {
+            options.max_threads = static_cast<unsigned>(std::stoul(value));
+        } else if (flag == "--messages") {
+            options.messages = std::stoul(value);
+        } else if (flag == "--output") {
+            options.output = value;
+        } else if (flag == "--sinks") {
+            options.sinks.clear( );
+            std::stringstream list(value);
+            for (std::string name; std::getline(list, name, ',');)
+                options.sinks.push_back(name);
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+        }
+    }
+    options.max_threads = std::max(1u, options.max_threads);
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options = parse_options(argc, argv);
+
+#ifdef LOGGER_HAS_ZSTD
+    if (std::find(options.sinks.begin( ), options.sinks.end( ), "zstd") ==
+        options.sinks.end( ))
+        options.sinks.push_back("zstd");
+#endif
+
+    auto& logger = Logger::get_instance( );
+    logger.set_console_output(false);
+    logger.set_level(Logger::LogLevel::INFO);
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < options.max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(options.max_threads);
+
+    std::vector<Scenario> scenarios;
+    for (const auto& sink : options.sinks) {
+        if (!sink_available(sink)) {
+            std::cerr << "unknown sink " << sink << ", skipping\n";
+            continue;
+        }
+        for (unsigned threads : thread_counts) {
+            for (size_t bytes : {16, 256, 4096})
+                scenarios.push_back({sink, threads, bytes, Call::TEXT});
+            if (sink == "null") {
+                scenarios.push_back({sink, threads, 256, Call::KV});
+                scenarios.push_back({sink, threads, 256, Call::FILTERED});
+            }
+        }
+    }
+
+    std::ofstream output(options.output, std::ios::trunc);
+    std::cerr << std::left << std::setw(8) << "sink" << std::setw(10) << "call"
+              << std::setw(8) << "threads" << std::setw(8) << "bytes"
+              << std::setw(14) << "produce/s" << std::setw(14) << "sustain/s"
+              << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns"
+              << "p99.9 ns\n";
+
+    for (const auto& scenario : scenarios) {
+        Result result = run(scenario, options.messages);
+        output << to_json(scenario, result) << "\n";
+
+        std::cerr << std::left << std::fixed << std::setprecision(0)
+                  << std::setw(8) << scenario.sink << std::setw(10)
+                  << call_name(scenario.call) << std::setw(8)
+                  << scenario.threads << std::setw(8) << scenario.message_bytes
+                  << std::setw(14)
+                  << result.messages / result.producer_seconds << std::setw(14)
+                  << result.messages / result.sustained_seconds
+                  << std::setw(10) << result.p50_ns << std::setw(10)
+                  << result.p99_ns << result.p999_ns << "\n";
+    }
+
+    logger.shutdown( );
+    return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef COMPRESSING_FILE_SINK_H
+#define COMPRESSING_FILE_SINK_H
+
+#ifdef LOGGER_HAS_ZSTD
+
+#include <zstd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log_sink.h"
+
+/**
+ * File sink that zstd-compresses every batch on the sink's own thread.
+ *
+ * Each batch is compressed with ZSTD_e_flush, so everything written so far can
+ * be decoded by a streaming reader (`zstd -dc`), and a frame is closed every
+ * `frame_bytes` of input. A crash therefore costs at most the tail of the
+ * last frame -- the file is a plain concatenation of zstd frames.
+ *
+ * Every run starts a new file: one left by a crash ends inside a frame, and
+ * frames appended after it could not be read. An existing file is kept, moved
+ * aside the way RotatingFileSink numbers its files (`name.1` the newest), and
+ * nothing is ever deleted. A compression or write error leaves the file as it
+ * is and fails the sink for good; every write then throws, which the logger
+ * counts in get_errors( ), rather than append frames a reader would stop
+ * short of.
+ */
+class CompressingFileSink : public EncodingSink {
+public:
+    explicit CompressingFileSink(const std::string& filename,
+                                 int                compression_level = 1,
+                                 size_t             frame_bytes = 4 << 20,
+                                 LogLevel           level  = LogLevel::TRACE,
+                                 LogFormat          format = LogFormat::TEXT)
+        : EncodingSink(level, format),
+          _file(move_aside(filename), std::ios::binary),
+          _frame_bytes(frame_bytes),
+          _context(ZSTD_createCCtx( )),
+          _out(ZSTD_CStreamOutSize( )) {
+        if (!_context)
+            throw std::runtime_error("Failed to create zstd context");
+        ZSTD_CCtx_setParameter(_context, ZSTD_c_compressionLevel,
+                               compression_level);
+    }
+
+    ~CompressingFileSink( ) override {
+        if (_frame_in > 0 && !_failed) {
+            try {
+                compress({ }, ZSTD_e_end);
+            } catch (const std::exception&) {
+                // nothing left to report it to
+            }
+        }
+        ZSTD_freeCCtx(_context);
+    }
+
+    bool is_open( ) const { return _file.is_open( ); }
+
+    // a compression or write error stopped the sink
+    bool has_failed( ) const {
+        return _failed.load(std::memory_order_relaxed);
+    }
+
+    // totals over the sink's lifetime -- safe to read from any thread
+    size_t get_bytes_in( ) const {
+        return _bytes_in.load(std::memory_order_relaxed);
+    }
+
+    size_t get_bytes_out( ) const {
+        return _bytes_out.load(std::memory_order_relaxed);
+    }
+
+    double get_compression_ratio( ) const {
+        size_t out = get_bytes_out( );
+        return out == 0 ? 0.0 : static_cast<double>(get_bytes_in( )) / out;
+    }
+
+    // input MB per second spent inside the compressor (file I/O excluded)
+    double get_throughput_mb_per_sec( ) const {
+        double seconds = _compress_ns.load(std::memory_order_relaxed) / 1e9;
+        if (seconds == 0.0) return 0.0;
+        return get_bytes_in( ) / (1024.0 * 1024.0) / seconds;
+    }
+
+protected:
+    void write(std::string_view bytes) override {
+        if (!_file.is_open( )) return;
+        if (_failed.load(std::memory_order_relaxed))
+            throw std::runtime_error("CompressingFileSink failed earlier");
+
+        _frame_in += bytes.size( );
+        bool end_frame = _frame_in >= _frame_bytes;
+        compress(bytes, end_frame ? ZSTD_e_end : ZSTD_e_flush);
+        if (end_frame) _frame_in = 0;
+
+        _bytes_in.fetch_add(bytes.size( ), std::memory_order_relaxed);
+    }
+
+private:
+    std::ofstream     _file;
+    size_t            _frame_bytes;
+    size_t            _frame_in = 0;
+    ZSTD_CCtx*        _context;
+    std::vector<char> _out;
+
+    std::atomic<bool>     _failed{false};
+    std::atomic<size_t>   _bytes_in{0};
+    std::atomic<size_t>   _bytes_out{0};
+    std::atomic<uint64_t> _compress_ns{0};
+
+    // frees `filename` for this run: name.1 .. name.k move up one, up to the
+    // first free number, and the previous file becomes name.1
+    static const std::string& move_aside(const std::string& filename) {
+        namespace fs = std::filesystem;
+        std::error_code error;
+        if (!fs::exists(filename, error)) return filename;
+
+        auto numbered = [&filename](size_t n) {
+            return filename + "." + std::to_string(n);
+        };
+        size_t first_free = 1;
+        while (fs::exists(numbered(first_free), error)) ++first_free;
+        for (size_t n = first_free; n > 1; --n) {
+            auto from = numbered(n - 1);
+            if (std::rename(from.c_str( ), numbered(n).c_str( )) != 0)
+                throw std::runtime_error("Failed to rotate " + from);
+        }
+        if (std::rename(filename.c_str( ), numbered(1).c_str( )) != 0)
+            throw std::runtime_error("Failed to rotate " + filename);
+        return filename;
+    }
+
+    void compress(std::string_view bytes, ZSTD_EndDirective mode) {
+        ZSTD_inBuffer input{bytes.data( ), bytes.size( ), 0};
+        size_t        remaining = 0;
+        do {
+            ZSTD_outBuffer output{_out.data( ), _out.size( ), 0};
+
+            auto start = std::chrono::steady_clock::now( );
+            remaining  = ZSTD_compressStream2(_context, &output, &input, mode);
+            _compress_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now( ) - start)
+                    .count( ),
+                std::memory_order_relaxed);
+
+            if (ZSTD_isError(remaining))
+                fail(std::string("zstd: ") + ZSTD_getErrorName(remaining));
+
+            _file.write(_out.data( ), static_cast<std::streamsize>(output.pos));
+            if (!_file) fail("write failed");
+            _bytes_out.fetch_add(output.pos, std::memory_order_relaxed);
+        } while (remaining != 0);
+
+        _file.flush( );
+        if (!_file) fail("flush failed");
+    }
+
+    // part of the open frame may be on disk already: nothing more is written
+    [[noreturn]] void fail(const std::string& reason) {
+        _failed.store(true, std::memory_order_relaxed);
+        throw std::runtime_error("CompressingFileSink: " + reason);
+    }
+};
+
+#endif  // LOGGER_HAS_ZSTD
+
+#endif  // COMPRESSING_FILE_SINK_H
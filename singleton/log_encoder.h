@@ -0,0 +1,329 @@
+#ifndef LOG_ENCODER_H
+#define LOG_ENCODER_H
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "log_entry.h"
+
+/**
+ * Turns a LogEntry into bytes on the worker thread.
+ *
+ * Everything is appended straight into a caller-owned buffer that is reused
+ * between entries, so once the buffer has grown to the size of a typical
+ * record encoding does not allocate at all.
+ *
+ *  TEXT   -- "[timestamp] [LEVEL] message key=value ...\n"
+ *  JSON   -- one object per line: {"ts":..,"level":..,"msg":..,<fields>}
+ *  BINARY -- length-prefixed record, host byte order:
+ *              u32 record length (excluding this prefix)
+ *              i64 timestamp (microseconds since epoch)
+ *              u8  level
+ *              u32 message length, message bytes
+ *              u16 field count, then per field:
+ *                u8 type, u16 key length, key bytes,
+ *                INT/UINT/DOUBLE: 8 bytes | BOOL: 1 byte |
+ *                STRING: u32 length + bytes
+ *            Fields past the 65535th are dropped and keys are cut at 65535
+ *            bytes, so every record stays readable.
+ */
+class LogEncoder {
+public:
+    explicit LogEncoder(LogFormat format = LogFormat::TEXT)
+        : _format(format) {}
+
+    LogFormat get_format( ) const { return _format; }
+    void      set_format(LogFormat format) { _format = format; }
+
+    void encode(const LogEntry& entry, std::string& out) {
+        switch (_format) {
+            case LogFormat::TEXT:
+                encode_text(entry, out);
+                break;
+            case LogFormat::JSON:
+                encode_json(entry, out);
+                break;
+            case LogFormat::BINARY:
+                encode_binary(entry, out);
+                break;
+        }
+    }
+
+    static const char* level_to_string(LogLevel level) {
+        switch (level) {
+            case LogLevel::TRACE:
+                return "TRACE";
+            case LogLevel::DEBUG:
+                return "DEBUG";
+            case LogLevel::INFO:
+                return "INFO";
+            case LogLevel::WARNING:
+                return "WARNING";
+            case LogLevel::ERROR:
+                return "ERROR";
+            case LogLevel::CRITICAL:
+                return "CRITICAL";
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+private:
+    LogFormat   _format;
+    std::time_t _cached_second = -1;
+    char        _cached_prefix[32]{ };
+    size_t      _cached_prefix_length = 0;
+
+    // "YYYY-mm-dd HH:MM:SS" only changes once a second -- strftime is not
+    // worth paying for on every record
+    void append_timestamp(std::chrono::system_clock::time_point time,
+                          std::string&                          out) {
+        auto since_epoch = time.time_since_epoch( );
+        auto seconds =
+            std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      since_epoch - seconds)
+                      .count( );
+
+        std::time_t second = seconds.count( );
+        if (second != _cached_second) {
+            std::tm local{ };
+            localtime_r(&second, &local);
+            _cached_prefix_length =
+                std::strftime(_cached_prefix, sizeof(_cached_prefix),
+                              "%Y-%m-%d %H:%M:%S", &local);
+            _cached_second = second;
+        }
+
+        out.append(_cached_prefix, _cached_prefix_length);
+        char millis[4] = {'.', static_cast<char>('0' + ms / 100),
+                          static_cast<char>('0' + ms / 10 % 10),
+                          static_cast<char>('0' + ms % 10)};
+        out.append(millis, sizeof(millis));
+    }
+
+    template <typename T>
+    static void append_number(T value, std::string& out) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    static void append_value(const LogEntry& entry, const LogField& field,
+                             std::string& out) {
+        switch (field.type) {
+            case LogFieldType::INT:
+                append_number(field.num.i, out);
+                break;
+            case LogFieldType::UINT:
+                append_number(field.num.u, out);
+                break;
+            case LogFieldType::DOUBLE:
+                append_number(field.num.d, out);
+                break;
+            case LogFieldType::BOOL:
+                out.append(field.num.b ? "true" : "false");
+                break;
+            case LogFieldType::STRING:
+                out.append(entry.string_value(field));
+                break;
+        }
+    }
+
+    void encode_text(const LogEntry& entry, std::string& out) {
+        out.push_back('[');
+        append_timestamp(entry.timestamp, out);
+        out.append("] [");
+        out.append(level_to_string(entry.level));
+        out.append("] ");
+        out.append(entry.message);
+
+        for (const auto& field : entry.fields) {
+            out.push_back(' ');
+            out.append(entry.key(field));
+            out.push_back('=');
+
+            if (field.type == LogFieldType::STRING &&
+                needs_quotes(entry.string_value(field))) {
+                append_text_quoted(entry.string_value(field), out);
+            } else {
+                append_value(entry, field, out);
+            }
+        }
+
+        out.push_back('\n');
+    }
+
+    static bool needs_quotes(std::string_view value) {
+        for (char ch : value) {
+            auto c = static_cast<unsigned char>(ch);
+            if (c < 0x20 || c == 0x7f || c == ' ' || c == '=' || c == '"' ||
+                c == '\\')
+                return true;
+        }
+        return false;
+    }
+
+    // quoted, with quotes, backslashes and control characters escaped, so a
+    // value can neither end its field early nor start a forged line
+    static void append_text_quoted(std::string_view value, std::string& out) {
+        static const char hex[] = "0123456789abcdef";
+
+        out.push_back('"');
+        for (char ch : value) {
+            auto c = static_cast<unsigned char>(ch);
+            switch (c) {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                case '\t':
+                    out.append("\\t");
+                    break;
+                default:
+                    if (c < 0x20 || c == 0x7f) {
+                        char escaped[4] = {'\\', 'x', hex[c >> 4],
+                                           hex[c & 0xf]};
+                        out.append(escaped, sizeof(escaped));
+                    } else {
+                        out.push_back(ch);
+                    }
+            }
+        }
+        out.push_back('"');
+    }
+
+    static void append_json_string(std::string_view value, std::string& out) {
+        static const char hex[] = "0123456789abcdef";
+
+        out.push_back('"');
+        size_t run_start = 0;
+        for (size_t i = 0; i < value.size( ); ++i) {
+            auto c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            out.append(value.data( ) + run_start, i - run_start);
+            run_start = i + 1;
+
+            switch (c) {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                case '\t':
+                    out.append("\\t");
+                    break;
+                default: {
+                    char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4],
+                                       hex[c & 0xf]};
+                    out.append(escaped, sizeof(escaped));
+                }
+            }
+        }
+        out.append(value.data( ) + run_start, value.size( ) - run_start);
+        out.push_back('"');
+    }
+
+    void encode_json(const LogEntry& entry, std::string& out) {
+        out.append("{\"ts\":\"");
+        append_timestamp(entry.timestamp, out);
+        out.append("\",\"level\":\"");
+        out.append(level_to_string(entry.level));
+        out.append("\",\"msg\":");
+        append_json_string(entry.message, out);
+
+        for (const auto& field : entry.fields) {
+            out.push_back(',');
+            append_json_string(entry.key(field), out);
+            out.push_back(':');
+
+            if (field.type == LogFieldType::STRING) {
+                append_json_string(entry.string_value(field), out);
+            } else if (field.type == LogFieldType::DOUBLE &&
+                       !std::isfinite(field.num.d)) {
+                out.append("null");  // JSON has no NaN / Infinity
+            } else {
+                append_value(entry, field, out);
+            }
+        }
+
+        out.append("}\n");
+    }
+
+    template <typename T>
+    static void append_raw(T value, std::string& out) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    void encode_binary(const LogEntry& entry, std::string& out) {
+        size_t length_at = out.size( );
+        append_raw(std::uint32_t{0}, out);  // patched below
+
+        append_raw(static_cast<std::int64_t>(
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           entry.timestamp.time_since_epoch( ))
+                           .count( )),
+                   out);
+        append_raw(static_cast<std::uint8_t>(entry.level), out);
+        append_raw(static_cast<std::uint32_t>(entry.message.size( )), out);
+        out.append(entry.message);
+        // the u16 counts are clamped, never wrapped
+        constexpr size_t u16_max = 0xffff;
+        size_t field_count = std::min(entry.fields.size( ), u16_max);
+        append_raw(static_cast<std::uint16_t>(field_count), out);
+
+        for (size_t i = 0; i < field_count; ++i) {
+            const auto& field = entry.fields[i];
+            auto key = entry.key(field).substr(0, u16_max);
+            append_raw(static_cast<std::uint8_t>(field.type), out);
+            append_raw(static_cast<std::uint16_t>(key.size( )), out);
+            out.append(key);
+
+            switch (field.type) {
+                case LogFieldType::INT:
+                case LogFieldType::UINT:
+                case LogFieldType::DOUBLE:
+                    append_raw(field.num, out);
+                    break;
+                case LogFieldType::BOOL:
+                    append_raw(static_cast<std::uint8_t>(field.num.b), out);
+                    break;
+                case LogFieldType::STRING:
+                    append_raw(field.str_length, out);
+                    out.append(entry.string_value(field));
+                    break;
+            }
+        }
+
+        auto length = static_cast<std::uint32_t>(out.size( ) - length_at -
+                                                 sizeof(std::uint32_t));
+        std::memcpy(out.data( ) + length_at, &length, sizeof(length));
+    }
+};
+
+#endif  // LOG_ENCODER_H
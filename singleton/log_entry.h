@@ -0,0 +1,151 @@
+#ifndef LOG_ENTRY_H
+#define LOG_ENTRY_H
+
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class LogLevel { TRACE, DEBUG, INFO, WARNING, ERROR, CRITICAL, OFF };
+
+// output encodings understood by LogEncoder
+enum class LogFormat { TEXT, JSON, BINARY };
+
+enum class LogFieldType : std::uint8_t { INT, UINT, DOUBLE, BOOL, STRING };
+
+// numeric payload of a field; STRING fields keep their bytes elsewhere
+union LogNumber {
+    std::int64_t  i;
+    std::uint64_t u;
+    double        d;
+    bool          b;
+};
+
+/**
+ * A typed key/value pair captured at the call site.
+ *
+ * It only holds views -- nothing is stringified or copied on the caller until
+ * the logger moves the bytes into the entry. Build them with kv(...).
+ */
+struct LogKV {
+    std::string_view key;
+    LogFieldType     type = LogFieldType::STRING;
+    LogNumber        num{};
+    std::string_view str{};
+};
+
+inline LogKV kv(std::string_view key, std::string_view value) {
+    LogKV field{key, LogFieldType::STRING};
+    field.str = value;
+    return field;
+}
+
+inline LogKV kv(std::string_view key, const char* value) {
+    return kv(key, std::string_view(value));
+}
+
+inline LogKV kv(std::string_view key, const std::string& value) {
+    return kv(key, std::string_view(value));
+}
+
+inline LogKV kv(std::string_view key, bool value) {
+    LogKV field{key, LogFieldType::BOOL};
+    field.num.b = value;
+    return field;
+}
+
+template <std::signed_integral T>
+LogKV kv(std::string_view key, T value) {
+    LogKV field{key, LogFieldType::INT};
+    field.num.i = value;
+    return field;
+}
+
+template <std::unsigned_integral T>
+    requires(!std::same_as<T, bool>)
+LogKV kv(std::string_view key, T value) {
+    LogKV field{key, LogFieldType::UINT};
+    field.num.u = value;
+    return field;
+}
+
+template <std::floating_point T>
+LogKV kv(std::string_view key, T value) {
+    LogKV field{key, LogFieldType::DOUBLE};
+    field.num.d = static_cast<double>(value);
+    return field;
+}
+
+/**
+ * A field as stored inside a LogEntry -- key and string payloads live in the
+ * entry's `field_data` arena, so a record with N fields costs two allocations
+ * in total instead of one (or more) per field.
+ */
+struct LogField {
+    LogFieldType  type       = LogFieldType::STRING;
+    std::uint32_t key_offset = 0;
+    std::uint32_t key_length = 0;
+    std::uint32_t str_offset = 0;
+    std::uint32_t str_length = 0;
+    LogNumber     num{};
+};
+
+struct LogEntry {
+    LogLevel                              level;
+    std::string                           message;
+    std::chrono::system_clock::time_point timestamp;
+    std::vector<LogField>                 fields;
+    std::string                           field_data;
+
+    LogEntry(LogLevel lvl, std::string msg,
+             std::chrono::system_clock::time_point ts)
+        : level(lvl), message(std::move(msg)), timestamp(ts) {}
+
+    LogEntry(LogLevel lvl, std::string msg,
+             std::chrono::system_clock::time_point ts,
+             std::initializer_list<LogKV>          kvs)
+        : LogEntry(lvl, std::move(msg), ts) {
+        size_t bytes = 0;
+        for (const auto& field : kvs) {
+            bytes += field.key.size( );
+            if (field.type == LogFieldType::STRING) bytes += field.str.size( );
+        }
+
+        fields.reserve(kvs.size( ));
+        field_data.reserve(bytes);
+
+        for (const auto& field : kvs) {
+            LogField stored{field.type};
+            stored.key_offset = static_cast<std::uint32_t>(field_data.size( ));
+            stored.key_length = static_cast<std::uint32_t>(field.key.size( ));
+            field_data.append(field.key);
+
+            if (field.type == LogFieldType::STRING) {
+                stored.str_offset =
+                    static_cast<std::uint32_t>(field_data.size( ));
+                stored.str_length =
+                    static_cast<std::uint32_t>(field.str.size( ));
+                field_data.append(field.str);
+            } else {
+                stored.num = field.num;
+            }
+
+            fields.push_back(stored);
+        }
+    }
+
+    std::string_view key(const LogField& field) const {
+        return std::string_view(field_data).substr(field.key_offset,
+                                                   field.key_length);
+    }
+
+    std::string_view string_value(const LogField& field) const {
+        return std::string_view(field_data).substr(field.str_offset,
+                                                   field.str_length);
+    }
+};
+
+#endif  // LOG_ENTRY_H
@@ -0,0 +1,227 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "log_encoder.h"
+#include "log_entry.h"
+
+/**
+ * A destination for log entries.
+ *
+ * The logger gives every sink its own queue and drain thread, so `consume` and
+ * `flush` are only ever called from that one thread and need no locking. A
+ * batch is a run of `consume` calls followed by one `flush`. Exceptions they
+ * throw are caught and counted (get_errors), and draining goes on.
+ */
+class LogSink {
+public:
+    explicit LogSink(LogLevel level = LogLevel::TRACE) : _level(level) {}
+    virtual ~LogSink( ) = default;
+
+    LogSink(const LogSink&)            = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    void set_level(LogLevel level) {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel get_level( ) const {
+        return _level.load(std::memory_order_relaxed);
+    }
+
+    bool should_log(LogLevel level) const { return level >= get_level( ); }
+
+    // entries dropped because this sink fell too far behind (see
+    // Logger::add_sink's max_pending)
+    size_t get_dropped( ) const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    size_t get_written( ) const {
+        return _written.load(std::memory_order_relaxed);
+    }
+
+    // exceptions thrown by consume (the entry is lost) or flush
+    size_t get_errors( ) const {
+        return _errors.load(std::memory_order_relaxed);
+    }
+
+    virtual void consume(const LogEntry& entry) = 0;
+    virtual void flush( ) {}
+
+private:
+    friend class Logger;
+
+    std::atomic<LogLevel> _level;
+    std::atomic<size_t>   _dropped{0};
+    std::atomic<size_t>   _written{0};
+    std::atomic<size_t>   _errors{0};
+};
+
+/**
+ * Base for sinks that write encoded bytes. Entries of a batch are encoded into
+ * one reused buffer that is handed to `write` once, on `flush`.
+ */
+class EncodingSink : public LogSink {
+public:
+    explicit EncodingSink(LogLevel  level  = LogLevel::TRACE,
+                          LogFormat format = LogFormat::TEXT)
+        : LogSink(level), _format(format) {}
+
+    void set_format(LogFormat format) {
+        _format.store(format, std::memory_order_relaxed);
+    }
+
+    LogFormat get_format( ) const {
+        return _format.load(std::memory_order_relaxed);
+    }
+
+    void consume(const LogEntry& entry) override {
+        _encoder.set_format(get_format( ));
+        _encoder.encode(entry, _buffer);
+    }
+
+    void flush( ) override {
+        if (_buffer.empty( )) return;
+        write(_buffer);
+        _buffer.clear( );
+    }
+
+protected:
+    virtual void write(std::string_view bytes) = 0;
+
+private:
+    std::atomic<LogFormat> _format;
+    LogEncoder             _encoder;
+    std::string            _buffer;
+};
+
+class ConsoleSink : public EncodingSink {
+public:
+    using EncodingSink::EncodingSink;
+
+protected:
+    void write(std::string_view bytes) override {
+        std::cout.write(bytes.data( ), bytes.size( ));
+        std::cout.flush( );
+    }
+};
+
+class FileSink : public EncodingSink {
+public:
+    explicit FileSink(const std::string& filename,
+                      LogLevel           level  = LogLevel::TRACE,
+                      LogFormat          format = LogFormat::TEXT)
+        : EncodingSink(level, format),
+          _file(filename, std::ios::app | std::ios::binary) {}
+
+    bool is_open( ) const { return _file.is_open( ); }
+
+protected:
+    void write(std::string_view bytes) override {
+        if (!_file.is_open( )) return;
+        _file.write(bytes.data( ), bytes.size( ));
+        _file.flush( );
+    }
+
+private:
+    std::ofstream _file;
+};
+
+/**
+ * Rolls `name` over to `name.1`, `name.1` to `name.2`, ... once it grows past
+ * `max_bytes`, keeping at most `max_files` old files around.
+ */
+class RotatingFileSink : public EncodingSink {
+public:
+    RotatingFileSink(const std::string& filename, size_t max_bytes,
+                     size_t max_files, LogLevel level = LogLevel::TRACE,
+                     LogFormat format = LogFormat::TEXT)
+        : EncodingSink(level, format),
+          _filename(filename),
+          _max_bytes(max_bytes),
+          _max_files(max_files) {
+        open( );
+    }
+
+protected:
+    void write(std::string_view bytes) override {
+        if (!_file.is_open( )) return;
+
+        // rotate between batches only -- a batch is never split over files
+        if (_current_size > 0 && _current_size + bytes.size( ) > _max_bytes)
+            rotate( );
+
+        _file.write(bytes.data( ), bytes.size( ));
+        _file.flush( );
+        _current_size += bytes.size( );
+    }
+
+private:
+    std::string   _filename;
+    size_t        _max_bytes;
+    size_t        _max_files;
+    size_t        _current_size = 0;
+    std::ofstream _file;
+
+    void open( ) {
+        _file.open(_filename, std::ios::app | std::ios::binary);
+        _current_size = _file.is_open( ) ? static_cast<size_t>(_file.tellp( ))
+                                         : 0;
+    }
+
+    void rotate( ) {
+        _file.close( );
+
+        if (_max_files == 0) {
+            std::remove(_filename.c_str( ));
+        } else {
+            auto numbered = [this](size_t n) {
+                return _filename + "." + std::to_string(n);
+            };
+            std::remove(numbered(_max_files).c_str( ));
+            for (size_t n = _max_files; n > 1; --n)
+                std::rename(numbered(n - 1).c_str( ), numbered(n).c_str( ));
+            std::rename(_filename.c_str( ), numbered(1).c_str( ));
+        }
+
+        open( );
+    }
+};
+
+/**
+ * Encodes like any other sink and then throws the bytes away -- measures the
+ * logger itself without any I/O.
+ */
+class NullSink : public EncodingSink {
+public:
+    using EncodingSink::EncodingSink;
+
+protected:
+    void write(std::string_view) override {}
+};
+
+/**
+ * Hands every entry to a user callback on the sink's own thread.
+ */
+class CallbackSink : public LogSink {
+public:
+    using Callback = std::function<void(const LogEntry&)>;
+
+    explicit CallbackSink(Callback callback, LogLevel level = LogLevel::TRACE)
+        : LogSink(level), _callback(std::move(callback)) {}
+
+    void consume(const LogEntry& entry) override { _callback(entry); }
+
+private:
+    Callback _callback;
+};
+
+#endif  // LOG_SINK_H
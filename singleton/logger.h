@@ -12,12 +12,19 @@
 #include <iostream>
 #include <mutex>
 #include <ratio>
+#include <memory>
 #include <sstream>
-#include <unordered_map>
+#include <thread>
+#include <vector>
+
+#include "log_encoder.h"
+#include "log_entry.h"
+#include "log_sink.h"
 
 class Logger {
 public:
-    enum class LogLevel { TRACE, DEBUG, INFO, WARNING, ERROR, CRITICAL, OFF };
+    using LogLevel  = ::LogLevel;
+    using LogFormat = ::LogFormat;
 
     // returns the created instance
     static Logger& get_instance( ) {
@@ -29,15 +36,83 @@ public:
         _current_level.store(level, std::memory_order_relaxed);
     }
 
+    // convenience wrappers that manage one FileSink / ConsoleSink; the sink
+    // and its worker are swapped under the config lock, like the baseline's
+    // flags were
     void set_file_output(const std::string& filename) {
-        std::lock_guard<std::mutex> lock(_config_mutex);
-        _log_file.open(filename, std::ios::app);
-        _log_to_file = _log_file.is_open( );
+        auto sink = std::make_shared<FileSink>(filename, LogLevel::TRACE,
+                                               _format.load( ));
+        if (!sink->is_open( )) sink = nullptr;
+        auto added = sink ? std::make_unique<SinkWorker>(sink, 0) : nullptr;
+
+        std::unique_ptr<SinkWorker> removed;
+        {
+            std::lock_guard<std::mutex> lock(_config_mutex);
+            removed    = take_worker(_file_sink);
+            _file_sink = std::move(sink);
+            if (added) _sinks.push_back(std::move(added));
+        }
+        // stopping drains the worker's queue -- keep that outside the lock
+        if (removed) removed->stop( );
     }
 
     void set_console_output(bool enabled) {
+        {
+            std::lock_guard<std::mutex> lock(_config_mutex);
+            if (enabled == static_cast<bool>(_console_sink)) return;
+        }
+
+        std::shared_ptr<ConsoleSink> sink;
+        std::unique_ptr<SinkWorker>  added;
+        if (enabled) {
+            sink = std::make_shared<ConsoleSink>(LogLevel::TRACE,
+                                                 _format.load( ));
+            added = std::make_unique<SinkWorker>(sink, 0);
+        }
+
+        std::unique_ptr<SinkWorker> removed;
+        {
+            std::lock_guard<std::mutex> lock(_config_mutex);
+            // another call got there first
+            if (enabled == static_cast<bool>(_console_sink)) return;
+            removed       = take_worker(_console_sink);
+            _console_sink = std::move(sink);
+            if (added) _sinks.push_back(std::move(added));
+        }
+        if (removed) removed->stop( );
+    }
+
+    // TEXT (default), JSON lines or length-prefixed BINARY records for the
+    // console / file outputs above; other sinks carry their own format
+    void set_format(LogFormat format) {
         std::lock_guard<std::mutex> lock(_config_mutex);
-        _log_to_console = enabled;
+        _format.store(format);
+        if (_console_sink) _console_sink->set_format(format);
+        if (_file_sink) _file_sink->set_format(format);
+    }
+
+    /**
+     * Attaches a sink with its own queue and drain thread, so a slow sink
+     * never holds up the others. Entries below the sink's level are not
+     * queued for it. With `max_pending` > 0 entries are dropped (and counted
+     * in LogSink::get_dropped) once that many are waiting for the sink.
+     */
+    void add_sink(std::shared_ptr<LogSink> sink, size_t max_pending = 0) {
+        auto worker =
+            std::make_unique<SinkWorker>(std::move(sink), max_pending);
+        std::lock_guard<std::mutex> lock(_config_mutex);
+        _sinks.push_back(std::move(worker));
+    }
+
+    // detaches the sink after it has written everything queued for it
+    void remove_sink(const std::shared_ptr<LogSink>& sink) {
+        std::unique_ptr<SinkWorker> removed;
+        {
+            std::lock_guard<std::mutex> lock(_config_mutex);
+            removed = take_worker(sink);
+        }
+        // stopping drains the worker's queue -- keep that outside the lock
+        if (removed) removed->stop( );
     }
 
     // logging methods
@@ -71,12 +146,49 @@ public:
         log(LogLevel::CRITICAL, format, std::forward<Args>(args)...);
     }
 
+    // structured logging -- fields are typed key/value pairs built with kv(),
+    // e.g. info_kv("request done", {kv("status", 200), kv("path", path)})
+    void trace_kv(std::string_view             message,
+                  std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::TRACE, message, fields);
+    }
+
+    void debug_kv(std::string_view             message,
+                  std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::DEBUG, message, fields);
+    }
+
+    void info_kv(std::string_view             message,
+                 std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::INFO, message, fields);
+    }
+
+    void warning_kv(std::string_view             message,
+                    std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::WARNING, message, fields);
+    }
+
+    void error_kv(std::string_view             message,
+                  std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::ERROR, message, fields);
+    }
+
+    void critical_kv(std::string_view             message,
+                     std::initializer_list<LogKV> fields) {
+        log_kv(LogLevel::CRITICAL, message, fields);
+    }
+
     // performance metrics
     void count_logged_messages( ) {
         _total_logged.fetch_add(1, std::memory_order_relaxed);
     }
 
-    size_t get_pending_logs( ) const { return _log_queue.size_approx( ); }
+    size_t get_pending_logs( ) const {
+        size_t                      pending = _log_queue.size_approx( );
+        std::lock_guard<std::mutex> lock(_config_mutex);
+        for (const auto& worker : _sinks) pending += worker->pending( );
+        return pending;
+    }
 
     size_t get_total_logs_processed( ) const {
         return _logs_processed.load(std::memory_order_relaxed);
@@ -96,6 +208,25 @@ public:
                static_cast<double>(_logs_processed.load( ));
     }
 
+    // blocks until everything logged so far has been written by every sink
+    void flush( ) {
+        // entries actually queued -- filtered ones never reach the worker
+        size_t queued = _enqueued.load( );
+        while (_logs_processed.load( ) < queued)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+        // the lock is only held to look, so dispatch() is never held up
+        while (true) {
+            bool idle = true;
+            {
+                std::lock_guard<std::mutex> lock(_config_mutex);
+                for (auto& worker : _sinks) idle = idle && worker->idle( );
+            }
+            if (idle) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
     void shutdown( ) {
         _running = false;
         _condition.notify_all( );
@@ -103,6 +234,11 @@ public:
             _worker_thread.join( );
         }
 
+        {
+            std::lock_guard<std::mutex> lock(_config_mutex);
+            for (auto& worker : _sinks) worker->stop( );
+        }
+
         // Final dump of queue state for debugging
         std::cout << "\nLogger shutdown. Queue state: "
                   << "Total logged: " << _total_logged
@@ -112,14 +248,99 @@ public:
     }
 
 private:
-    struct LogEntry {
-        LogLevel                              level;
-        std::string                           message;
-        std::chrono::system_clock::time_point timestamp;
-
-        LogEntry(LogLevel lvl, const std::string& msg,
-                 std::chrono::system_clock::time_point ts)
-            : level(lvl), message(msg), timestamp(ts) {}
+    /**
+     * Owns the queue and drain thread of one sink. Entries are shared between
+     * all sinks through the same shared_ptr -- nothing is copied per sink.
+     */
+    class SinkWorker {
+    public:
+        SinkWorker(std::shared_ptr<LogSink> sink, size_t max_pending)
+            : _sink(std::move(sink)), _max_pending(max_pending) {
+            _thread = std::thread(&SinkWorker::run, this);
+        }
+
+        ~SinkWorker( ) { stop( ); }
+
+        const std::shared_ptr<LogSink>& sink( ) const { return _sink; }
+
+        size_t pending( ) const { return _queue.size_approx( ); }
+
+        // everything pushed so far has been consumed and flushed
+        bool idle( ) const { return _done.load( ) == _pushed.load( ); }
+
+        // called by the dispatcher only
+        void push(const std::shared_ptr<const LogEntry>& entry) {
+            if (_max_pending > 0 && _queue.size_approx( ) >= _max_pending) {
+                _sink->_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            _queue.enqueue(entry);
+            _pushed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void notify( ) {
+            // taking the lock closes the gap between the predicate check and
+            // the wait in run()
+            { std::lock_guard<std::mutex> lock(_mutex); }
+            _condition.notify_one( );
+        }
+
+        void stop( ) {
+            _running = false;
+            notify( );
+            if (_thread.joinable( )) _thread.join( );
+        }
+
+    private:
+        std::shared_ptr<LogSink> _sink;
+        size_t                   _max_pending;
+        std::atomic<bool>        _running{true};
+        std::atomic<size_t>      _pushed{0};
+        std::atomic<size_t>      _done{0};
+
+        moodycamel::ConcurrentQueue<std::shared_ptr<const LogEntry>> _queue;
+        std::thread                                                  _thread;
+        std::condition_variable                                      _condition;
+        std::mutex                                                   _mutex;
+
+        void run( ) {
+            const size_t                    BATCH_SIZE = 128;
+            std::shared_ptr<const LogEntry> batch[BATCH_SIZE];
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _condition.wait(lock, [this] {
+                        return !_running || _queue.size_approx( ) > 0;
+                    });
+                }
+
+                size_t count = _queue.try_dequeue_bulk(batch, BATCH_SIZE);
+                if (count == 0) {
+                    if (!_running) break;
+                    continue;
+                }
+
+                // a throwing sink costs its entry, never the process
+                size_t written = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    try {
+                        _sink->consume(*batch[i]);
+                        ++written;
+                    } catch (...) {
+                        _sink->_errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    batch[i].reset( );
+                }
+                try {
+                    _sink->flush( );
+                } catch (...) {
+                    _sink->_errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                _sink->_written.fetch_add(written, std::memory_order_relaxed);
+                _done.fetch_add(count);
+            }
+        }
     };
 
     std::atomic<LogLevel> _current_level;
@@ -127,26 +348,28 @@ private:
     std::atomic<size_t>   _logs_processed;
     std::atomic<size_t>   _total_logged;
     std::atomic<size_t>   _filtered_logs;
+    std::atomic<size_t>   _enqueued{0};  // accepted and queued, for flush()
     std::atomic<double>   _total_processing_time_ms;
 
-    bool          _log_to_console;
-    bool          _log_to_file;
-    std::ofstream _log_file;
+    std::atomic<LogFormat>                   _format;
+    std::shared_ptr<ConsoleSink>             _console_sink;
+    std::shared_ptr<FileSink>                _file_sink;
+    std::vector<std::unique_ptr<SinkWorker>> _sinks;
 
-    moodycamel::ConcurrentQueue<std::unique_ptr<LogEntry>> _log_queue;
-    std::thread                                            _worker_thread;
-    std::condition_variable                                _condition;
-    std::mutex                                             _mutex;
-    std::mutex                                             _config_mutex;
+    moodycamel::ConcurrentQueue<std::shared_ptr<const LogEntry>> _log_queue;
+    std::thread                                                  _worker_thread;
+    std::condition_variable                                      _condition;
+    std::mutex                                                   _mutex;
+    mutable std::mutex                                           _config_mutex;
 
     // our logger is a singleton -- so a hidden  constructor
     Logger( )
         : _current_level(LogLevel::INFO),
-          _log_to_console(true),
-          _log_to_file(false),
           _running(true),
           _logs_processed(0),
-          _total_processing_time_ms(0.0) {
+          _total_processing_time_ms(0.0),
+          _format(LogFormat::TEXT) {
+        set_console_output(true);
         _worker_thread = std::thread(&Logger::process_log_queue, this);
     }
 
@@ -179,45 +402,62 @@ private:
         std::string formatted_message =
             format_string(format, std::forward<Args>(args)...);
 
-        auto now = std::chrono::system_clock::now( );
-        auto log_entry =
-            std::make_unique<LogEntry>(level, formatted_message, now);
+        auto now       = std::chrono::system_clock::now( );
+        auto log_entry = std::make_shared<const LogEntry>(
+            level, std::move(formatted_message), now);
+
+        _log_queue.enqueue(std::move(log_entry));
+        _enqueued.fetch_add(1);
+        _condition.notify_one( );
+    }
+
+    void log_kv(LogLevel level, std::string_view message,
+                std::initializer_list<LogKV> fields) {
+        _total_logged.fetch_add(1, std::memory_order_relaxed);
+
+        if (level < _current_level.load(std::memory_order_relaxed)) {
+            _filtered_logs.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto now       = std::chrono::system_clock::now( );
+        auto log_entry = std::make_shared<const LogEntry>(
+            level, std::string(message), now, fields);
 
         _log_queue.enqueue(std::move(log_entry));
+        _enqueued.fetch_add(1);
         _condition.notify_one( );
     }
 
+    // fans entries out to the sink workers; actual writes happen on their
+    // threads
     void process_log_queue( ) {
-        const size_t BATCH_SIZE = 128;
+        const size_t                    BATCH_SIZE = 128;
+        std::shared_ptr<const LogEntry> batch[BATCH_SIZE];
 
         while (_running || _log_queue.size_approx( ) > 0) {
             bool have_logs = false;
 
-            // wait for remaining logs or shutdown
+            // wait for remaining logs or shutdown; producers notify without
+            // the lock, so a wakeup can be missed -- never sleep for long
             {
                 std::unique_lock<std::mutex> lock(_mutex);
-                _condition.wait(lock, [this] {
-                    return !_running || _log_queue.size_approx( ) > 0;
-                });
+                _condition.wait_for(
+                    lock, std::chrono::milliseconds(10), [this] {
+                        return !_running || _log_queue.size_approx( ) > 0;
+                    });
 
                 have_logs = _log_queue.size_approx( ) > 0;
             }
 
             if (have_logs) {
-                size_t                    count = 0;
-                std::unique_ptr<LogEntry> entry;
-
                 auto start_time = std::chrono::high_resolution_clock::now( );
 
-                while (count < BATCH_SIZE && _log_queue.try_dequeue(entry)) {
-                    if (entry) {
-                        write_log_entry(*entry);
-                        _logs_processed.fetch_add(1, std::memory_order_relaxed);
-                        count++;
-                    }
-                }
-
+                size_t count = _log_queue.try_dequeue_bulk(batch, BATCH_SIZE);
                 if (count > 0) {
+                    dispatch(batch, count);
+                    _logs_processed.fetch_add(count, std::memory_order_relaxed);
+
                     auto end_time = std::chrono::high_resolution_clock::now( );
                     auto duration = std::chrono::duration<double, std::milli>(
                                         end_time - start_time)
@@ -228,44 +468,34 @@ private:
         }
     }
 
-    static const char* level_to_string(LogLevel level) {
-        static const std::unordered_map<LogLevel, const char*> level_strings = {
-            {LogLevel::TRACE, "TRACE"}, {LogLevel::DEBUG, "DEBUG"},
-            {LogLevel::INFO, "INFO"},   {LogLevel::WARNING, "WARNING"},
-            {LogLevel::ERROR, "ERROR"}, {LogLevel::CRITICAL, "CRITICAL"}};
-
-        auto it = level_strings.find(level);
-        return (it != level_strings.end( )) ? it->second : "UNKNOWN";
-    }
-
-    static std::string format_timestamp(
-        std::chrono::system_clock::time_point time) {
-        auto in_time_t = std::chrono::system_clock::to_time_t(time);
-        auto ms        = std::chrono::duration_cast<std::chrono::milliseconds>(
-            time.time_since_epoch( ) % std::chrono::seconds(1));
-
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
-        ss << '.' << std::setfill('0') << std::setw(3) << ms.count( );
-
-        return ss.str( );
+    // detaches the sink's worker, if any; call with _config_mutex held
+    std::unique_ptr<SinkWorker> take_worker(
+        const std::shared_ptr<LogSink>& sink) {
+        if (!sink) return nullptr;
+        for (auto it = _sinks.begin( ); it != _sinks.end( ); ++it) {
+            if ((*it)->sink( ) == sink) {
+                auto removed = std::move(*it);
+                _sinks.erase(it);
+                return removed;
+            }
+        }
+        return nullptr;
     }
 
-    void write_log_entry(const LogEntry& entry) {
-        std::ostringstream log_stream;
-        log_stream << "[" << format_timestamp(entry.timestamp) << "] " << "["
-                   << level_to_string(entry.level) << "] " << entry.message
-                   << std::endl;
-        std::string formatted_log = log_stream.str( );
-
+    void dispatch(std::shared_ptr<const LogEntry>* batch, size_t count) {
         std::lock_guard<std::mutex> lock(_config_mutex);
 
-        if (_log_to_console) std::cout << formatted_log;
-
-        if (_log_to_file && _log_file.is_open( )) {
-            _log_file << formatted_log;
-            _log_file.flush( );
+        for (auto& worker : _sinks) {
+            bool queued = false;
+            for (size_t i = 0; i < count; ++i) {
+                if (!worker->sink( )->should_log(batch[i]->level)) continue;
+                worker->push(batch[i]);
+                queued = true;
+            }
+            if (queued) worker->notify( );
         }
+
+        for (size_t i = 0; i < count; ++i) batch[i].reset( );
     }
 };
 
@@ -276,4 +506,17 @@ private:
 #define LOG_ERROR(...)    Logger::get_instance( ).error(__VA_ARGS__)
 #define LOG_CRITICAL(...) Logger::get_instance( ).critical(__VA_ARGS__)
 
+#define LOG_TRACE_KV(msg, ...) \
+    Logger::get_instance( ).trace_kv(msg, {__VA_ARGS__})
+#define LOG_DEBUG_KV(msg, ...) \
+    Logger::get_instance( ).debug_kv(msg, {__VA_ARGS__})
+#define LOG_INFO_KV(msg, ...) \
+    Logger::get_instance( ).info_kv(msg, {__VA_ARGS__})
+#define LOG_WARNING_KV(msg, ...) \
+    Logger::get_instance( ).warning_kv(msg, {__VA_ARGS__})
+#define LOG_ERROR_KV(msg, ...) \
+    Logger::get_instance( ).error_kv(msg, {__VA_ARGS__})
+#define LOG_CRITICAL_KV(msg, ...) \
+    Logger::get_instance( ).critical_kv(msg, {__VA_ARGS__})
+
 #endif  // LOGGER_H
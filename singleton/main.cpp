@@ -2,6 +2,7 @@
 #include <random>
 #include <thread>
 
+#include "compressing_file_sink.h"
 #include "logger.h"
 
 std::atomic<int> completed_threads(0);
@@ -52,12 +53,22 @@ int main( ) {
     logger.set_console_output(true);
     logger.set_file_output("logs/__test__.log");
 
+#ifdef LOGGER_HAS_ZSTD
+    // same stream again, zstd-compressed on its own sink thread
+    auto compressed_sink =
+        std::make_shared<CompressingFileSink>("logs/__test__.log.zst");
+    logger.add_sink(compressed_sink);
+#endif
+
     // test params
     const int         num_threads     = 16;
     const int         logs_per_thread = 10000;
     std::atomic<bool> start_flag(false);
     completed_threads.store(0);
 
+    LOG_INFO_KV("logger configured", kv("threads", num_threads),
+                kv("logs_per_thread", logs_per_thread), kv("file_output", true));
+
     std::cout << "Starting logging performance test with " << num_threads
               << " threads, each generating " << logs_per_thread
               << " log messages\n";
@@ -145,6 +156,13 @@ int main( ) {
     std::cout << "Logs per second: " << std::fixed << std::setprecision(1) << logs_per_second << "\n";
     std::cout << "Average processing time: " << std::fixed << std::setprecision(6) 
               << avg_process_time << " ms\n";
+#ifdef LOGGER_HAS_ZSTD
+    std::cout << "Compressed sink: " << compressed_sink->get_bytes_in( )
+              << " -> " << compressed_sink->get_bytes_out( ) << " bytes (ratio "
+              << std::setprecision(2) << compressed_sink->get_compression_ratio( )
+              << "x, " << std::setprecision(1)
+              << compressed_sink->get_throughput_mb_per_sec( ) << " MB/s)\n";
+#endif
     std::cout << "\nThis demonstrates that the Logger singleton is both thread-safe and non-blocking.\n";
     std::cout << "The main thread never waits for logging operations to complete.\n";
 